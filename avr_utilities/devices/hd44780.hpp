@@ -8,7 +8,9 @@
 #ifndef HD44780_HPP_
 #define HD44780_HPP_
 #include "avr_utilities/pin_definitions.hpp"
+#if !defined(AVR_UTILITIES_SIMULATION)
 #include <util/delay.h> // for _delay_ms
+#endif
 
 
 namespace hd44780
@@ -95,7 +97,7 @@ public:
     {
         using namespace commands;
         make_output( pins.e | pins.rw | pins.rs | pins.data);
-        reset( pins.rs);
+        reset( pins.rs | pins.rw);
 
         // following the Hitachi datasheet
         // HD44780U (LCD-II)/ADE-207-272(Z)/'99.9/rev 0.0
@@ -174,20 +176,20 @@ private:
     {
         if (set_rs)
         {
-            set( pins.rs);
+            assign( pins.rs, pins.rw);
         }
         else
         {
-            reset( pins.rs);
+            reset( pins.rs | pins.rw);
         }
         outnibble( byte >> 4);
         outnibble( byte & 0x0f);
         wait_ready();
     }
 
+    /// send a nibble, assuming the rw pin is low.
     static void outnibble( byte nibble)
     {
-        reset( pins.rw);
         write( pins.data, nibble);
         set( pins.e);
         delay_500ns();
@@ -198,20 +200,20 @@ private:
     {
         if (set_rs)
         {
-            set( pins.rs);
+            set( pins.rs | pins.rw);
         }
         else
         {
-            reset( pins.rs);
+            assign( pins.rw, pins.rs);
         }
         byte result =innibble() << 4;
         return result | innibble();
     }
 
+    /// receive a nibble, assuming the rw pin is high.
     static byte innibble()
     {
         byte result;
-        set( pins.rw);
         make_input( pins.data);
         set( pins.e);
         delay_500ns();
@@ -0,0 +1,243 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_DEVICES_SOFTWARE_UART_HPP_
+#define AVR_UTILITIES_DEVICES_SOFTWARE_UART_HPP_
+#include "avr_utilities/round_robin_buffer.h"
+#include "avr_utilities/pin_definitions.hpp"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/**
+ * Use this macro to let a software uart handle the timer 1 compare match interrupts.
+ */
+#define IMPLEMENT_SOFTWARE_UART_INTERRUPTS( uart_)  \
+    ISR( TIMER1_COMPA_vect)                         \
+    {                                               \
+        uart_.transmit_interrupt();                 \
+    }                                               \
+    ISR( TIMER1_COMPB_vect)                         \
+    {                                               \
+        uart_.receive_interrupt();                  \
+    }                                               \
+    /**/
+
+namespace serial
+{
+    /**
+     * Interrupt driven uart on arbitrary pins, with the same buffered interface as serial::uart.
+     *
+     * Bit timing is done with the compare match units of timer 1, which runs freely at F_CPU:
+     * compare unit A times the transmitted bits and compare unit B the samples of received bits.
+     * Because the CPU is only busy during the interrupt handlers, one per bit, transmitting and
+     * receiving can happen at the same time and do not block the main program.
+     * The falling edge of a start bit is detected with a pin change interrupt. The application
+     * connects the uart to a pin change dispatcher (see pin_change_interrupt.hpp):
+     * \code
+     * serial::software_uart< PIN_TYPE( D, 5), PIN_TYPE( D, 4), 9600> gps;
+     * IMPLEMENT_SOFTWARE_UART_INTERRUPTS( gps)
+     *
+     * void on_gps_rx( bool level) { gps.receive_edge_interrupt( level);}
+     * typedef pin_definitions::cons< pin_change::handler< PIN_TYPE( D, 4), on_gps_rx> > handlers;
+     * IMPLEMENT_PIN_CHANGE_INTERRUPTS( handlers)
+     *
+     * int main()
+     * {
+     *     pin_change::dispatcher< handlers>::init();
+     *     ...
+     *     if (gps.data_available()) ... gps.get();
+     * }
+     * \endcode
+     *
+     * The software uart uses 8n1 frames and owns timer 1: the timer must not be reconfigured
+     * by other code. Other interrupt handlers delay the bit timing by their own duration, so at
+     * higher baud rates they must be short.
+     */
+    template< typename tx_pin, typename rx_pin, uint32_t baud_rate,
+              uint16_t output_buffer_size = 32, uint16_t input_buffer_size = output_buffer_size>
+    class software_uart
+    {
+    public:
+        /// number of timer ticks per bit.
+        static const uint16_t bit_ticks = (F_CPU + baud_rate / 2) / baud_rate;
+
+        static_assert( (F_CPU + baud_rate / 2) / baud_rate <= 0xffff, "baud rate too low for a software uart at this F_CPU");
+        static_assert( bit_ticks >= 200, "baud rate too high for a software uart at this F_CPU");
+
+        software_uart()
+        : tx_idle( true), tx_frame( 0), tx_bits( 0), rx_byte( 0), rx_bits( 0)
+        {
+            init();
+        }
+
+        /// configure the pins and timer 1. The pin change interrupt of the rx pin must be
+        /// enabled separately.
+        static void init()
+        {
+            set( tx_pin());
+            make_output( tx_pin());
+            set( rx_pin()); // pull-up
+            make_input( rx_pin());
+
+            // normal mode, no prescaler.
+            TCCR1A = 0;
+            TCCR1B = _BV( CS10);
+            TIMSK1 &= ~(_BV( OCIE1A) | _BV( OCIE1B));
+
+            sei();
+        }
+
+        /**
+         * This function must be called from the timer 1 compare match A interrupt.
+         * IMPLEMENT_SOFTWARE_UART_INTERRUPTS does this.
+         */
+        void transmit_interrupt() volatile
+        {
+            if (not tx_bits)
+            {
+                // the stop bit of the previous byte has been sent.
+                uint8_t byte;
+                if (not output_buffer.read( &byte))
+                {
+                    TIMSK1 &= ~_BV( OCIE1A);
+                    tx_idle = true;
+                    return;
+                }
+
+                // start bit, data bits lsb first, stop bit.
+                tx_frame = (static_cast<uint16_t>( byte) << 1) | 0x200;
+                tx_bits = 10;
+            }
+
+            if (tx_frame & 1) set( tx_pin());
+            else reset( tx_pin());
+
+            tx_frame >>= 1;
+            --tx_bits;
+            OCR1A += bit_ticks;
+        }
+
+        /**
+         * This function must be called when the level of the rx pin changes. Normally this is
+         * done by a pin change dispatcher, see the example at the top of this class.
+         */
+        void receive_edge_interrupt( bool level) volatile
+        {
+            if (level or rx_bits) return;
+
+            // a start bit. Sample the data bits in their middle.
+            OCR1B = TCNT1 + bit_ticks + bit_ticks / 2;
+            TIFR1 = _BV( OCF1B);
+            TIMSK1 |= _BV( OCIE1B);
+            rx_bits = 9;
+            rx_byte = 0;
+        }
+
+        /**
+         * This function must be called from the timer 1 compare match B interrupt.
+         * IMPLEMENT_SOFTWARE_UART_INTERRUPTS does this.
+         */
+        void receive_interrupt() volatile
+        {
+            const bool level = is_set( rx_pin());
+            if (--rx_bits)
+            {
+                rx_byte >>= 1;
+                if (level) rx_byte |= 0x80;
+                OCR1B += bit_ticks;
+            }
+            else
+            {
+                // this is the stop bit. Bytes without a valid stop bit are dropped.
+                TIMSK1 &= ~_BV( OCIE1B);
+                if (level && input_buffer.write_tentative( rx_byte))
+                {
+                    input_buffer.commit();
+                }
+            }
+        }
+
+        /// send a zero-terminated string. If the string does not fit in the output buffer,
+        /// this function sends it in parts, waiting for room in between.
+        void send( const char *message) volatile
+        {
+            while (*message)
+            {
+                while (*message && output_buffer.write_tentative( static_cast<uint8_t>( *message)))
+                {
+                    ++message;
+                }
+                commit();
+            }
+        }
+
+        void send( uint8_t value) volatile
+        {
+            while (!output_buffer.write_tentative( value)) /*repeat*/;
+            commit();
+        }
+
+        bool data_available() const volatile
+        {
+            return !input_buffer.empty();
+        }
+
+        // get one byte from the uart.
+        uint8_t get() volatile
+        {
+            return input_buffer.read_w();
+        }
+
+        bool is_sending() const volatile
+        {
+            return !tx_idle;
+        }
+
+        // Arduino compatibility functions
+        bool available() const volatile
+        {
+            return data_available();
+        }
+
+        uint8_t read() volatile
+        {
+            return get();
+        }
+
+        void write( uint8_t value) volatile
+        {
+            send( value);
+        }
+
+    private:
+        /// make the appended bytes available to the transmit interrupt and start it if it
+        /// was idle.
+        void commit() volatile
+        {
+            round_robin_detail::critical_section guard;
+            output_buffer.commit();
+            if (tx_idle && !output_buffer.empty())
+            {
+                tx_idle = false;
+                tx_bits = 0;
+                OCR1A = TCNT1 + bit_ticks;
+                TIFR1 = _BV( OCF1A);
+                TIMSK1 |= _BV( OCIE1A);
+            }
+        }
+
+        bool     tx_idle;
+        uint16_t tx_frame;  ///< bits that still have to be sent, lsb first
+        uint8_t  tx_bits;   ///< number of bits in tx_frame
+        uint8_t  rx_byte;
+        uint8_t  rx_bits;   ///< number of bits that still have to be sampled
+        round_robin_buffer<output_buffer_size> output_buffer;
+        round_robin_buffer<input_buffer_size>  input_buffer;
+    };
+}
+#endif /* AVR_UTILITIES_DEVICES_SOFTWARE_UART_HPP_ */
@@ -8,62 +8,637 @@
 #ifndef AVR_UTILITIES_DEVICES_UART_H_
 #define AVR_UTILITIES_DEVICES_UART_H_
 #include "avr_utilities/round_robin_buffer.h"
+#include "avr_utilities/flash_string.hpp"
+#include "avr_utilities/pin_definitions.hpp"
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+
+// Interrupt vector names per USART. Devices with a single USART name
+// the vectors of USART 0 without a number.
+#if defined(USART_RX_vect)
+#   define SERIAL_USART0_RX_VECT_   USART_RX_vect
+#   define SERIAL_USART0_UDRE_VECT_ USART_UDRE_vect
+#   define SERIAL_USART0_TX_VECT_   USART_TX_vect
+#else
+#   define SERIAL_USART0_RX_VECT_   USART0_RX_vect
+#   define SERIAL_USART0_UDRE_VECT_ USART0_UDRE_vect
+#   define SERIAL_USART0_TX_VECT_   USART0_TX_vect
+#endif
+#define SERIAL_USART1_RX_VECT_   USART1_RX_vect
+#define SERIAL_USART1_UDRE_VECT_ USART1_UDRE_vect
+#define SERIAL_USART1_TX_VECT_   USART1_TX_vect
+#define SERIAL_USART2_RX_VECT_   USART2_RX_vect
+#define SERIAL_USART2_UDRE_VECT_ USART2_UDRE_vect
+#define SERIAL_USART2_TX_VECT_   USART2_TX_vect
+#define SERIAL_USART3_RX_VECT_   USART3_RX_vect
+#define SERIAL_USART3_UDRE_VECT_ USART3_UDRE_vect
+#define SERIAL_USART3_TX_VECT_   USART3_TX_vect
+
+/**
+ * Use this macro to enable UART interrupt handling by a specific UART object
+ * that uses USART 'usart_' (a literal number, e.g. 1), for example:
+ * \code
+ * serial::uart< 32, 32, 1> gps( 9600);
+ * IMPLEMENT_USART_INTERRUPT( 1, gps)
+ * \endcode
+ */
+#define IMPLEMENT_USART_INTERRUPT( usart_, uart_)           \
+    ISR( SERIAL_USART##usart_##_UDRE_VECT_)                 \
+    {                                                       \
+        uart_.output_buffer_empty_interrupt();              \
+    }                                                       \
+    ISR( SERIAL_USART##usart_##_RX_VECT_)                   \
+    {                                                       \
+        uart_.input_buffer_full_interrupt();                \
+    }                                                       \
+    /**/
+
+/**
+ * A uart on a half duplex bus (see half_duplex) also needs its transmit complete
+ * interrupt. Use this macro in addition to IMPLEMENT_USART_INTERRUPT for such a uart:
+ * \code
+ * IMPLEMENT_USART_INTERRUPT( 1, bus)
+ * IMPLEMENT_USART_TX_INTERRUPT( 1, bus)
+ * \endcode
+ * Full duplex uarts leave the vector free for other use.
+ */
+#define IMPLEMENT_USART_TX_INTERRUPT( usart_, uart_)        \
+    ISR( SERIAL_USART##usart_##_TX_VECT_)                   \
+    {                                                       \
+        uart_.transmit_complete_interrupt();                \
+    }                                                       \
+    /**/
 
 /**
  * Use this macro to enable UART interrupt handling by
- * a specific UART object.
+ * a specific UART object on USART 0.
  */
 #define IMPLEMENT_UART_INTERRUPT( uart_)            \
-    ISR( USART_UDRE_vect)                           \
-    {                                               \
-        uart_.output_buffer_empty_interrupt();      \
-    }                                               \
-    ISR( USART_RX_vect)                             \
-    {                                               \
-        uart_.input_buffer_full_interrupt();        \
-    }                                               \
+    IMPLEMENT_USART_INTERRUPT( 0, uart_)            \
+    /**/
+
+/**
+ * Use this macro to let a half duplex uart on USART 0 handle its transmit complete interrupt.
+ */
+#define IMPLEMENT_UART_TX_INTERRUPT( uart_)         \
+    IMPLEMENT_USART_TX_INTERRUPT( 0, uart_)         \
     /**/
 
 namespace serial
 {
+    /// The registers and bit numbers of one USART.
+    /// If you get a compile error about an incomplete type here, the mcu does not have a
+    /// USART with the requested number.
+    template< uint8_t usart>
+    struct usart_traits;
+
+#define DECLARE_USART_TRAITS( n_)                                           \
+    template<>                                                              \
+    struct usart_traits< n_>                                                \
+    {                                                                       \
+        static volatile uint8_t &udr()   { return UDR##n_;}                 \
+        static volatile uint8_t &ucsra() { return UCSR##n_##A;}             \
+        static volatile uint8_t &ucsrb() { return UCSR##n_##B;}             \
+        static volatile uint8_t &ucsrc() { return UCSR##n_##C;}             \
+        static volatile uint8_t &ubrrl() { return UBRR##n_##L;}             \
+        static volatile uint8_t &ubrrh() { return UBRR##n_##H;}             \
+        static const uint8_t rxcie = RXCIE##n_;                             \
+        static const uint8_t udrie = UDRIE##n_;                             \
+        static const uint8_t txcie = TXCIE##n_;                             \
+        static const uint8_t rxen  = RXEN##n_;                              \
+        static const uint8_t txen  = TXEN##n_;                              \
+        static const uint8_t ucsz0 = UCSZ##n_##0;                           \
+        static const uint8_t ucsz1 = UCSZ##n_##1;                           \
+        static const uint8_t ucsz2 = UCSZ##n_##2;                           \
+        static const uint8_t rxb8  = RXB8##n_;                              \
+        static const uint8_t txb8  = TXB8##n_;                              \
+        static const uint8_t mpcm  = MPCM##n_;                              \
+        static const uint8_t u2x   = U2X##n_;                               \
+        static const uint8_t dor   = DOR##n_;                               \
+        static const uint8_t fe    = FE##n_;                                \
+        static const uint8_t txc   = TXC##n_;                               \
+        static const uint8_t udre  = UDRE##n_;                              \
+    };                                                                      \
+    /**/
+
+#if defined(UDR0)
+    DECLARE_USART_TRAITS( 0)
+#endif
+#if defined(UDR1)
+    DECLARE_USART_TRAITS( 1)
+#endif
+#if defined(UDR2)
+    DECLARE_USART_TRAITS( 2)
+#endif
+#if defined(UDR3)
+    DECLARE_USART_TRAITS( 3)
+#endif
+
+#undef DECLARE_USART_TRAITS
+
+    /// The kinds of options of a uart. Each option type names its kind in a
+    /// 'category' typedef and a uart takes at most one option of each kind.
+    namespace option_category
+    {
+        struct baud_rate {};
+        struct framing {};
+        struct statistics {};
+        struct direction {};
+        struct addressing {};
+    }
+
+    /// Baud rate that is given to the uart constructor or to set_baudrate() at run time.
+    /// This is the default.
+    struct runtime_baud
+    {
+        typedef option_category::baud_rate category;
+        static const bool use_u2x = false;
+    };
+
+    namespace detail
+    {
+        /// error of the baud rate that a divisor gives, in 1/1000th of the requested rate.
+        /// 'samples' is the number of samples per bit: 16 in normal mode, 8 in U2X mode.
+        constexpr uint32_t baud_error_permille( uint32_t rate, uint32_t divisor, uint32_t samples)
+        {
+            return divisor == 0 ? 1000 :
+                    (F_CPU / (samples * divisor) > rate ?
+                        F_CPU / (samples * divisor) - rate : rate - F_CPU / (samples * divisor))
+                    * 1000UL / rate;
+        }
+    }
+
+    /**
+     * Baud rate that is fixed at compile time, e.g.
+     * \code
+     * serial::uart< 32, 32, 0, serial::baud< 38400> > console;
+     * \endcode
+     * The UBRR value is calculated for both normal and double speed (U2X) mode and
+     * the mode with the smallest error at F_CPU is used. Configurations with an
+     * error larger than max_error_permille (default 2%) do not compile. For example,
+     * 115200 baud at 16Mhz has an error of 2.1% and needs an explicit tolerance:
+     * serial::baud< 115200, 25>.
+     */
+    template< uint32_t rate, uint16_t max_error_permille = 20>
+    struct baud
+    {
+        typedef option_category::baud_rate category;
+
+        // divisors, rounded to the nearest integer.
+        static const uint32_t normal_divisor = (F_CPU + 8UL * rate) / (16UL * rate);
+        static const uint32_t u2x_divisor    = (F_CPU + 4UL * rate) / (8UL * rate);
+
+        static const uint32_t normal_error = detail::baud_error_permille( rate, normal_divisor, 16);
+        static const uint32_t u2x_error    = detail::baud_error_permille( rate, u2x_divisor, 8);
+
+        // U2X halves the number of samples per bit, so only use it when it is more accurate
+        // or when normal mode cannot reach the baud rate.
+        static const bool     use_u2x = u2x_error < normal_error;
+        static const uint32_t divisor = use_u2x ? u2x_divisor : normal_divisor;
+        static const uint16_t ubrr    = divisor - 1;
+        static const uint32_t error   = use_u2x ? u2x_error : normal_error;
+
+        static_assert( error <= max_error_permille, "baud rate cannot be reached accurately enough at this F_CPU");
+        static_assert( divisor <= 4096, "baud rate too low for this F_CPU");
+    };
+
+    /// Input framing of a uart that does not look for frames in the received data.
+    /// This is the default.
+    struct no_framing
+    {
+        typedef option_category::framing category;
+        static const bool    enabled = false;
+        static const uint8_t delimiter = 0;
+    };
+
+    /// Input framing of a uart whose receive interrupt handler counts the frames that
+    /// end with 'delimiter_'.
+    template< uint8_t delimiter_>
+    struct frame_delimiter
+    {
+        typedef option_category::framing category;
+        static const bool    enabled = true;
+        static const uint8_t delimiter = delimiter_;
+    };
+
+    /// frames that end with a SLIP END byte, as used by esp-link.
+    typedef frame_delimiter< 0xC0> slip_frames;
+
+    /// text lines that end with a newline character.
+    typedef frame_delimiter< '\n'> line_frames;
+
+    /// Line direction of a uart with separate transmit and receive lines. This is the default.
+    struct full_duplex
+    {
+        typedef option_category::direction category;
+        static const bool enabled = false;
+
+        static void init() {}
+        static void transmit() {}
+        static void release() {}
+    };
+
+    /**
+     * Line direction of a uart on a half duplex bus, such as RS-485. The uart drives
+     * 'driver_enable_pin' (a PIN_TYPE) high when it starts to transmit and low in the
+     * transmit complete interrupt, after the stop bit of the last byte has left the USART:
+     * \code
+     * serial::uart< 32, 32, 0, serial::baud< 19200>, serial::half_duplex< PIN_TYPE( D, 2)> > bus;
+     * IMPLEMENT_UART_INTERRUPT( bus)
+     * IMPLEMENT_UART_TX_INTERRUPT( bus)
+     * \endcode
+     */
+    template< typename driver_enable_pin>
+    struct half_duplex
+    {
+        typedef option_category::direction category;
+        static const bool enabled = true;
+
+        static void init()
+        {
+            reset( driver_enable_pin());
+            make_output( driver_enable_pin());
+        }
+
+        static void transmit()
+        {
+            set( driver_enable_pin());
+        }
+
+        static void release()
+        {
+            reset( driver_enable_pin());
+        }
+    };
+
+    /// Frames of 8 data bits without address frames. This is the default.
+    struct no_addressing
+    {
+        typedef option_category::addressing category;
+        static const bool enabled = false;
+    };
+
+    /**
+     * Multi-processor communication mode: 9-bit frames in which the ninth bit marks
+     * address frames. A node that listens to an address sets the MPCM bit of the USART,
+     * so that the hardware ignores data frames, without interrupts, until an address
+     * frame arrives. If the address matches, the uart receives the data frames that follow:
+     * \code
+     * serial::uart< 16, 16, 0, serial::baud< 38400>, serial::multiprocessor> bus;
+     * ...
+     * bus.listen( my_address);  // on a slave node
+     * ...
+     * bus.send_address( 12);    // on the master
+     * bus.send( "ping");
+     * \endcode
+     */
+    struct multiprocessor
+    {
+        typedef option_category::addressing category;
+        static const bool enabled = true;
+    };
+
+    /// Statistics policies of a uart.
+    namespace uart_statistics
+    {
+        /// no statistics are kept. This is the default and adds no code or data.
+        struct none
+        {
+            typedef option_category::statistics category;
+            static const bool enabled = false;
+
+            void count_rx_interrupt() volatile {}
+            void count_tx_interrupt() volatile {}
+            void count_overrun() volatile {}
+            void count_framing_error() volatile {}
+            void count_dropped( uint16_t = 1) volatile {}
+            void record_tx_level( uint16_t) volatile {}
+        };
+
+        /**
+         * The uart counts receive errors, dropped input and interrupt handler calls, and
+         * keeps track of the highest fill level of the output buffer. This helps to choose
+         * buffer sizes and baud rates:
+         * \code
+         * serial::uart< 32, 64, 0, serial::uart_statistics::counters> esp( 115200);
+         * ...
+         * if (esp.overruns() or esp.dropped()) ... // input is not read fast enough
+         * \endcode
+         * All counters saturate at 0xffff.
+         */
+        struct counters
+        {
+            typedef option_category::statistics category;
+            static const bool enabled = true;
+
+            counters()
+            : overrun_count( 0), framing_error_count( 0), dropped_count( 0),
+              rx_interrupt_count( 0), tx_interrupt_count( 0), tx_high_water( 0)
+            {
+            }
+
+            /// number of bytes that were lost because the interrupt handler was too late to
+            /// read them from the USART (data overrun).
+            uint16_t overruns() const volatile       { return round_robin_detail::load( overrun_count);}
+
+            /// number of received bytes with a missing stop bit, typically a baud rate mismatch.
+            uint16_t framing_errors() const volatile { return round_robin_detail::load( framing_error_count);}
+
+            /// number of received bytes that were dropped because the input buffer was full.
+            /// With input framing, this includes all bytes of a frame that did not fit.
+            uint16_t dropped() const volatile        { return round_robin_detail::load( dropped_count);}
+
+            /// number of calls of the receive interrupt handler.
+            uint16_t rx_interrupts() const volatile  { return round_robin_detail::load( rx_interrupt_count);}
+
+            /// number of calls of the data register empty interrupt handler.
+            uint16_t tx_interrupts() const volatile  { return round_robin_detail::load( tx_interrupt_count);}
+
+            /// the highest number of bytes that were waiting in the output buffer.
+            uint16_t tx_high_water_mark() const volatile { return round_robin_detail::load( tx_high_water);}
+
+            void reset_statistics() volatile
+            {
+                const uint8_t status = SREG;
+                cli();
+                overrun_count = 0;
+                framing_error_count = 0;
+                dropped_count = 0;
+                rx_interrupt_count = 0;
+                tx_interrupt_count = 0;
+                tx_high_water = 0;
+                SREG = status;
+            }
+
+            void count_rx_interrupt() volatile  { increment( rx_interrupt_count);}
+            void count_tx_interrupt() volatile  { increment( tx_interrupt_count);}
+            void count_overrun() volatile       { increment( overrun_count);}
+            void count_framing_error() volatile { increment( framing_error_count);}
+            void count_dropped( uint16_t count = 1) volatile { add( dropped_count, count);}
+
+            void record_tx_level( uint16_t level) volatile
+            {
+                if (level > tx_high_water) tx_high_water = level;
+            }
+
+        private:
+            static void increment( volatile uint16_t &counter)
+            {
+                if (counter != 0xffff) ++counter;
+            }
+
+            static void add( volatile uint16_t &counter, uint16_t count)
+            {
+                counter = (count > 0xffff - counter) ? 0xffff : counter + count;
+            }
+
+            volatile uint16_t overrun_count;
+            volatile uint16_t framing_error_count;
+            volatile uint16_t dropped_count;
+            volatile uint16_t rx_interrupt_count;
+            volatile uint16_t tx_interrupt_count;
+            volatile uint16_t tx_high_water;
+        };
+    }
+
+    /// A block of data that the UDRE interrupt handler sends directly from flash or RAM,
+    /// or a number of bytes that it takes from the output buffer.
+    struct transmit_descriptor
+    {
+        enum memory_space { output_buffer, ram, flash};
+
+        const uint8_t *data;
+        uint16_t       length;
+        uint8_t        space;
+
+        transmit_descriptor()
+        : data( 0), length( 0), space( output_buffer)
+        {
+        }
+
+        transmit_descriptor( const uint8_t *data, uint16_t length, memory_space space)
+        : data( data), length( length), space( space)
+        {
+        }
+
+        transmit_descriptor( const transmit_descriptor &other)
+        : data( other.data), length( other.length), space( other.space)
+        {
+        }
+
+        // descriptors are stored in a volatile buffer, so copies from and to volatile
+        // objects are needed.
+        transmit_descriptor( const volatile transmit_descriptor &other)
+        : data( other.data), length( other.length), space( other.space)
+        {
+        }
+
+        void operator=( const volatile transmit_descriptor &other)
+        {
+            data = other.data;
+            length = other.length;
+            space = other.space;
+        }
+
+        void operator=( const transmit_descriptor &other) volatile
+        {
+            data = other.data;
+            length = other.length;
+            space = other.space;
+        }
+    };
+
+    namespace detail
+    {
+        template< typename a, typename b>
+        struct same_category
+        {
+            static const bool value = false;
+        };
+
+        template< typename a>
+        struct same_category< a, a>
+        {
+            static const bool value = true;
+        };
+
+        template< bool matches, typename option, typename rest>
+        struct pick_option
+        {
+            typedef typename rest::type type;
+        };
+
+        template< typename option, typename rest>
+        struct pick_option< true, option, rest>
+        {
+            typedef option type;
+        };
+
+        /// meta function that selects the option of the given category from a list of
+        /// uart options, or 'default_option' if the list has none.
+        template< typename category, typename default_option, typename... options>
+        struct select_option
+        {
+            typedef default_option type;
+        };
+
+        template< typename category, typename default_option, typename head, typename... tail>
+        struct select_option< category, default_option, head, tail...>
+            : pick_option<
+                  same_category< typename head::category, category>::value,
+                  head,
+                  select_option< category, default_option, tail...> >
+        {
+        };
+
+        /// meta function that counts the options of the given category.
+        template< typename category, typename... options>
+        struct count_options
+        {
+            static const uint8_t value = 0;
+        };
+
+        template< typename category, typename head, typename... tail>
+        struct count_options< category, head, tail...>
+        {
+            static const uint8_t value = same_category< typename head::category, category>::value
+                    + count_options< category, tail...>::value;
+        };
+    }
+
     /**
      * This class eases using the AVRs UART. It provides buffered output and input.
      *
+     * The third template argument selects the USART on devices that have more than one.
+     * All register accesses resolve at compile time to the registers of that USART.
+     *
+     * Any further template arguments are options, in any order and at most one of each
+     * kind. Options that are not given take their default value, so enabling one feature
+     * does not require spelling out all others:
+     * \code
+     * serial::uart< 32, 32, 0, serial::multiprocessor, serial::baud< 38400> > bus;
+     * \endcode
+     *
+     * The baud rate option is either runtime_baud (the default), in which case the
+     * baud rate is given to the constructor, or a baud<> type, in which case the baud rate
+     * registers are set from constants and no division code is generated.
+     *
+     * Besides the output buffer, the uart has a small queue of transmit descriptors. With
+     * send_flash() and send_ram(), blocks of data are queued without copying them: the interrupt
+     * handler reads them directly from flash or RAM. Output that is appended to the output
+     * buffer while descriptors are queued is sent after them, so all output is sent in
+     * the order of the calls.
+     *
+     * The framing option selects input framing. With a frame_delimiter<> type,
+     * the receive interrupt handler counts the received delimiters, so that the main program
+     * only needs to look at the input when a complete frame has arrived:
+     * \code
+     * serial::uart< 32, 128, 0, serial::slip_frames> esp( 115200);
+     * ...
+     * uint8_t packet[128];
+     * if (esp.frames_available())
+     * {
+     *     const uint16_t length = esp.read_frame( packet, sizeof packet);
+     *     ...
+     * }
+     * \endcode
+     * Received bytes only become available when the delimiter that ends their frame
+     * arrives. A frame that does not fit in the input buffer is dropped completely and
+     * reception continues with the next frame.
+     *
+     * The statistics option is a policy from uart_statistics. With
+     * uart_statistics::counters, the uart counts receive errors and dropped bytes and
+     * these counters are available as member functions of the uart.
+     *
+     * The direction option is full_duplex (the default) or half_duplex<>, which
+     * controls the driver enable pin of a half duplex bus transceiver.
+     *
+     * The addressing option is no_addressing (the default) or multiprocessor, for
+     * 9-bit frames with address filtering by the USART.
      */
-    template< uint8_t output_buffer_size = 32, uint8_t input_buffer_size = output_buffer_size>
+    template< uint16_t output_buffer_size = 32, uint16_t input_buffer_size = output_buffer_size,
+              uint8_t usart = 0, typename... options>
     class uart
+        : public detail::select_option< option_category::statistics, uart_statistics::none, options...>::type
     {
     public:
+        // the selected options.
+        typedef typename detail::select_option< option_category::baud_rate,  runtime_baud,         options...>::type baud_rate;
+        typedef typename detail::select_option< option_category::framing,    no_framing,           options...>::type rx_framing;
+        typedef typename detail::select_option< option_category::statistics, uart_statistics::none, options...>::type statistics;
+        typedef typename detail::select_option< option_category::direction,  full_duplex,          options...>::type direction;
+        typedef typename detail::select_option< option_category::addressing, no_addressing,        options...>::type addressing;
+
+        static_assert(
+                    detail::count_options< option_category::baud_rate,  options...>::value
+                  + detail::count_options< option_category::framing,    options...>::value
+                  + detail::count_options< option_category::statistics, options...>::value
+                  + detail::count_options< option_category::direction,  options...>::value
+                  + detail::count_options< option_category::addressing, options...>::value
+                  == sizeof...(options),
+                "unknown uart option");
+        static_assert(
+                    detail::count_options< option_category::baud_rate,  options...>::value <= 1
+                and detail::count_options< option_category::framing,    options...>::value <= 1
+                and detail::count_options< option_category::statistics, options...>::value <= 1
+                and detail::count_options< option_category::direction,  options...>::value <= 1
+                and detail::count_options< option_category::addressing, options...>::value <= 1,
+                "a uart takes at most one option of each kind");
+
+        typedef typename round_robin_buffer<input_buffer_size>::index_type frame_count;
+
         uart( uint32_t baudrate)
-            :idle(true)
+            :idle(true), completed_frames( 0), rx_discarding( false), filtering( false), node_address( 0)
         {
+            static_assert( is_runtime_baud( baud_rate()), "the baud rate of this uart is set at compile time");
             set_baudrate( baudrate);
             init();
         }
 
+        /// constructor for uarts with a compile time baud rate.
+        uart()
+            :idle(true), completed_frames( 0), rx_discarding( false), filtering( false), node_address( 0)
+        {
+            static_assert( not is_runtime_baud( baud_rate()), "the baud rate of this uart must be given to the constructor");
+            set_baudrate();
+            init();
+        }
+
         static void set_baudrate( uint32_t baudrate)
         {
             const unsigned long timerVal
                 = ((F_CPU + 8UL * baudrate)/(16UL * baudrate)) - 1;
 
-            UBRR0L = (uint8_t)timerVal;
-            UBRR0H = (uint8_t)timerVal >> 8;
+            registers::ubrrl() = (uint8_t)timerVal;
+            registers::ubrrh() = (uint8_t)(timerVal >> 8);
+        }
+
+        /// set the baud rate registers to the compile time baud rate.
+        static void set_baudrate()
+        {
+            registers::ubrrl() = (uint8_t)baud_rate::ubrr;
+            registers::ubrrh() = (uint8_t)(baud_rate::ubrr >> 8);
         }
 
         static void init()
         {
-            UCSR0A = 0;
+            direction::init();
+            registers::ucsra() = baud_rate::use_u2x ? _BV( registers::u2x) : 0;
 
             // enable TX
             // enable UDR-empty interrupt
             // enable serial input interrupt and serial input.
-            UCSR0B = _BV( RXCIE0) | _BV( RXEN0) | _BV( TXEN0) | _BV( UDRIE0);
+            // on a half duplex bus, enable the transmit complete interrupt.
+            // in multi-processor mode, use 9-bit frames.
+            registers::ucsrb() = _BV( registers::rxcie) | _BV( registers::rxen) | _BV( registers::txen) | _BV( registers::udrie)
+                    | (direction::enabled ? _BV( registers::txcie) : 0)
+                    | (addressing::enabled ? _BV( registers::ucsz2) : 0);
 
             // 8-bits data, no parity, 1 stopbit (8n1)
-            UCSR0C = _BV( UCSZ01) | _BV( UCSZ00);
+            registers::ucsrc() = _BV( registers::ucsz1) | _BV( registers::ucsz0);
 
             // interrupts must be enabled for serial input to work.
             sei();
@@ -71,7 +646,7 @@ namespace serial
 
         static bool is_sending()
         {
-            return (UCSR0B & _BV(UDRIE0)) != 0;
+            return (registers::ucsrb() & _BV( registers::udrie)) != 0;
         }
 
         /**
@@ -89,39 +664,184 @@ namespace serial
          */
         void output_buffer_empty_interrupt() volatile
         {
+            this->count_tx_interrupt();
             uint8_t byte = 0;
 
             // try to read the next character to send
-            if (output_buffer.read( &byte))
+            if (next_byte( byte))
             {
                 // ... OK, send it.
-                UDR0 = byte;
+                if (addressing::enabled)
+                {
+                    // the bytes from the buffers are data frames.
+                    registers::ucsrb() &= ~_BV( registers::txb8);
+                }
+                registers::udr() = byte;
             }
             else
             {
                 // disable interrupt, we're idle
                 idle = true;
-                UCSR0B &= ~(1 << UDRIE0);
+                registers::ucsrb() &= ~(1 << registers::udrie);
             }
         }
 
         void input_buffer_full_interrupt() volatile
         {
-            register uint8_t in = UDR0;
-            input_buffer.write_tentative(in);
-            input_buffer.commit();
+            this->count_rx_interrupt();
+            if (statistics::enabled)
+            {
+                // the error flags are only valid until UDR is read.
+                const uint8_t status = registers::ucsra();
+                if (status & _BV( registers::dor)) this->count_overrun();
+                if (status & _BV( registers::fe))  this->count_framing_error();
+            }
+
+            // the ninth bit must be read before UDR.
+            if (addressing::enabled && (registers::ucsrb() & _BV( registers::rxb8)))
+            {
+                address_received( registers::udr());
+                return;
+            }
+
+            register uint8_t in = registers::udr();
+            if (rx_framing::enabled)
+            {
+                receive_framed( in);
+            }
+            else if (not input_buffer.write_tentative(in))
+            {
+                this->count_dropped();
+            }
+            else
+            {
+                input_buffer.commit();
+            }
         }
 
+        /**
+         * This function must be called from the transmit complete interrupt, which is only
+         * enabled for half duplex uarts. IMPLEMENT_USART_TX_INTERRUPT does this.
+         * The transmit complete interrupt occurs when the last stop bit has been sent and
+         * no new byte is waiting in the data register. If new output was committed in the
+         * mean time, the uart is no longer idle and keeps driving the bus.
+         */
+        void transmit_complete_interrupt() volatile
+        {
+            if (idle)
+            {
+                direction::release();
+            }
+        }
+
+        /// only receive the data frames that follow an address frame with 'address'.
+        void listen( uint8_t address) volatile
+        {
+            static_assert( addressing::enabled, "this uart does not use multi-processor mode");
+            round_robin_detail::critical_section guard;
+            node_address = address;
+            filtering = true;
+            set_mpcm( true);
+        }
+
+        /// receive all data frames, e.g. on the master of the bus. Address frames are ignored.
+        /// This is the initial state of a uart in multi-processor mode.
+        void listen_to_all() volatile
+        {
+            static_assert( addressing::enabled, "this uart does not use multi-processor mode");
+            round_robin_detail::critical_section guard;
+            filtering = false;
+            set_mpcm( false);
+        }
+
+        /**
+         * send an address frame. This waits until all earlier output has been handed to the
+         * USART, so that the address frame is sent after it. Output that is sent after this
+         * call follows the address frame as data frames.
+         */
+        void send_address( uint8_t address) volatile
+        {
+            static_assert( addressing::enabled, "this uart does not use multi-processor mode");
+            while (is_sending() || !(registers::ucsra() & _BV( registers::udre)))
+            {
+                /* wait for the transmitter to become idle */
+            }
+
+            round_robin_detail::critical_section guard;
+            direction::transmit();
+            registers::ucsrb() |= _BV( registers::txb8);
+            registers::udr() = address;
+        }
+
+        /// send a zero-terminated string. If the string does not fit in the output buffer,
+        /// this function sends it in parts, waiting for room in between.
         void send( const char *message) volatile
         {
-        	if (not message) return;
+            while ((message = send_some( message))) /* wait for room */;
+        }
 
-            while (*message)
+        /**
+         * Non-blocking send of a zero-terminated string.
+         * This sends as much of the string as fits in the output buffer and returns a pointer
+         * to the part that was not sent yet, or a null pointer if the whole string was sent.
+         * A long message can be streamed from the main loop without waiting for the uart:
+         * \code
+         * const char *pending = help_text;
+         * while (true)
+         * {
+         *     if (pending) pending = uart.send_some( pending);
+         *     ... // do other work
+         * }
+         * \endcode
+         */
+        const char *send_some( const char *message) volatile
+        {
+            if (not message) return 0;
+
+            while (*message && append( static_cast<uint8_t>(*message)))
             {
-                append( static_cast<uint8_t>(*message));
                 ++message;
             }
             commit();
+            return *message ? message : 0;
+        }
+
+        /// non-blocking send of a block of bytes. Returns the number of bytes that fitted in
+        /// the output buffer. The caller should offer the rest later.
+        uint16_t send_some( const uint8_t *data, uint16_t length) volatile
+        {
+            const uint16_t room = output_buffer.available();
+            if (length > room) length = room;
+            output_buffer.write_span( data, length);
+            commit();
+            return length;
+        }
+
+        /// queue a zero-terminated string in flash memory (e.g. F_("text")) for transmission.
+        /// The string is not copied, the interrupt handler reads it from flash.
+        /// If the descriptor queue is full, this function waits until there is room.
+        void send( const flash_string::helper *message) volatile
+        {
+            const char *string = reinterpret_cast<const char *>( message);
+            const uint16_t length = strlen_P( string);
+            while (!send_flash( string, length)) /* wait for room in the descriptor queue */;
+        }
+
+        /// queue 'length' bytes in flash memory for transmission, without copying them.
+        /// Returns false, without waiting, if the descriptor queue is full.
+        bool send_flash( const void *data, uint16_t length) volatile
+        {
+            return queue( transmit_descriptor(
+                    static_cast<const uint8_t *>( data), length, transmit_descriptor::flash));
+        }
+
+        /// queue 'length' bytes in RAM for transmission, without copying them.
+        /// The data must remain unchanged until it has been sent, see is_sending().
+        /// Returns false, without waiting, if the descriptor queue is full.
+        bool send_ram( const void *data, uint16_t length) volatile
+        {
+            return queue( transmit_descriptor(
+                    static_cast<const uint8_t *>( data), length, transmit_descriptor::ram));
         }
 
         void send( uint8_t value)
@@ -142,10 +862,57 @@ namespace serial
         }
 
 
+        /// return the number of complete frames in the input buffer.
+        frame_count frames_available() const volatile
+        {
+            static_assert( rx_framing::enabled, "this uart does not count input frames");
+            return round_robin_detail::load( completed_frames);
+        }
+
+        /**
+         * Read the oldest complete frame, including its delimiter, into 'destination'.
+         * Returns the number of bytes stored, or zero if no complete frame is available.
+         * If the frame is longer than 'size', only its first 'size' bytes are stored and
+         * the rest of the frame is discarded.
+         */
+        uint16_t read_frame( uint8_t *destination, uint16_t size) volatile
+        {
+            if (not frames_available()) return 0;
+
+            uint16_t stored = 0;
+            bool     found  = false;
+            while (not found)
+            {
+                // a delimiter is known to be in the buffer, so this ends after at
+                // most two contiguous regions.
+                const uint8_t *region;
+                uint16_t length = input_buffer.peek_span( region);
+                const uint8_t *end = static_cast<const uint8_t *>( memchr( region, rx_framing::delimiter, length));
+                if (end)
+                {
+                    length = end - region + 1;
+                    found = true;
+                }
+
+                const uint16_t copied = (length < size - stored) ? length : size - stored;
+                memcpy( destination + stored, region, copied);
+                stored += copied;
+                input_buffer.consume( length);
+            }
+
+            frame_consumed();
+            return stored;
+        }
+
         // get one byte from the uart.
         uint8_t get() volatile
         {
-            return input_buffer.read_w();
+            const uint8_t value = input_buffer.read_w();
+            if (rx_framing::enabled && value == rx_framing::delimiter)
+            {
+                frame_consumed();
+            }
+            return value;
         }
 
         // Arduino compatibility functions
@@ -165,20 +932,173 @@ namespace serial
         }
 
     private:
+        typedef usart_traits< usart> registers;
+
+        static constexpr bool is_runtime_baud( const runtime_baud &) { return true;}
+        template< typename other>
+        static constexpr bool is_runtime_baud( const other &) { return false;}
+
+        static const uint8_t descriptor_queue_size = 4;
+
         /// commit all appends since the previous commit.
         /// this will actually send the appended bytes to output.
+        /// While descriptors are being sent, new output must wait for its turn in the
+        /// descriptor queue. If that queue is full, this function waits, with interrupts
+        /// enabled, until the interrupt handler has taken a descriptor from it.
         void commit() volatile
         {
-            output_buffer.commit();
-            cli();
-            if (idle)
+            while (not try_commit())
+            {
+                while (descriptors.full()) /* wait for the interrupt handler */;
+            }
+        }
+
+        /// commit the appended output, unless it needs a descriptor and the descriptor
+        /// queue is full.
+        bool try_commit() volatile
+        {
+            round_robin_detail::critical_section guard;
+            const bool needs_descriptor = output_buffer.uncommitted() && descriptors_active();
+            if (needs_descriptor && descriptors.full()) return false;
+
+            // the number of bytes between the old and new write index. This does not
+            // include bytes that were appended but are not committed yet.
+            const uint16_t added = output_buffer.commit();
+            this->record_tx_level( output_buffer.size());
+            if (needs_descriptor)
+            {
+                descriptors.write_tentative( transmit_descriptor( 0, added, transmit_descriptor::output_buffer));
+                descriptors.commit();
+            }
+            start_transmitter();
+            return true;
+        }
+
+        /// add a descriptor to the queue and start sending.
+        bool queue( const transmit_descriptor &descriptor) volatile
+        {
+            if (not descriptor.length) return true;
+
+            round_robin_detail::critical_section guard;
+            // output that is still in the output buffer must be sent before the new descriptor.
+            const uint16_t pending = descriptors_active() ? 0 : output_buffer.size();
+            const bool fits = descriptors.available() >= (pending ? 2 : 1);
+            if (fits)
             {
-                // re-enable interrupt
-                UCSR0B |= (1 << UDRIE0);
-                UDR0 = output_buffer.read_w(); // start the UART and its interrupts
+                if (pending)
+                {
+                    descriptors.write_tentative( transmit_descriptor( 0, pending, transmit_descriptor::output_buffer));
+                }
+                descriptors.write_tentative( descriptor);
+                descriptors.commit();
+                start_transmitter();
+            }
+            return fits;
+        }
+
+        /// true if the interrupt handler is sending descriptors. Must be called with
+        /// interrupts disabled.
+        bool descriptors_active() const volatile
+        {
+            return current.length || !descriptors.empty();
+        }
+
+        /// enable the UDRE interrupt if it was disabled. Must be called with interrupts
+        /// disabled.
+        void start_transmitter() volatile
+        {
+            if (idle && (descriptors_active() || !output_buffer.empty()))
+            {
+                // the data register is empty, so the interrupt handler will run as soon
+                // as interrupts are enabled again.
+                direction::transmit();
+                registers::ucsrb() |= (1 << registers::udrie);
                 idle = false;
             }
-            sei();
+        }
+
+        /// find the next byte to send, from the current descriptor or from the output buffer.
+        bool next_byte( uint8_t &byte) volatile
+        {
+            if (not current.length)
+            {
+                transmit_descriptor next;
+                if (not descriptors.read( &next))
+                {
+                    return output_buffer.read( &byte);
+                }
+                current = next;
+            }
+
+            --current.length;
+            switch (current.space)
+            {
+            case transmit_descriptor::flash:
+                byte = pgm_read_byte( current.data);
+                ++current.data;
+                return true;
+            case transmit_descriptor::ram:
+                byte = *current.data;
+                ++current.data;
+                return true;
+            default:
+                return output_buffer.read( &byte);
+            }
+        }
+
+        /// set or clear the MPCM bit. The other bits of UCSRnA are either read-only, must be
+        /// written as zero or, as TXC, are cleared by writing a one, so UCSRnA is not read back.
+        static void set_mpcm( bool value)
+        {
+            registers::ucsra() =
+                      (baud_rate::use_u2x ? _BV( registers::u2x) : 0)
+                    | (value ? _BV( registers::mpcm) : 0);
+        }
+
+        /// handle a received address frame: receive the data frames that follow it only if
+        /// the address is ours.
+        void address_received( uint8_t address) volatile
+        {
+            if (filtering)
+            {
+                set_mpcm( address != node_address);
+            }
+        }
+
+        /**
+         * Store a received byte of a framed input stream. The bytes of a frame are only
+         * committed when its delimiter arrives, so the main program never sees an incomplete
+         * frame. If a frame does not fit in the input buffer, the part that was received is
+         * discarded and the rest of the frame is dropped up to and including its delimiter,
+         * after which the uart receives the next frame normally.
+         */
+        void receive_framed( uint8_t in) volatile
+        {
+            const bool is_delimiter = in == rx_framing::delimiter;
+            if (rx_discarding)
+            {
+                this->count_dropped();
+                rx_discarding = not is_delimiter;
+            }
+            else if (not input_buffer.write_tentative( in))
+            {
+                // the part of the frame that was received so far is lost as well.
+                this->count_dropped( input_buffer.uncommitted() + 1);
+                input_buffer.reset_tentative();
+                rx_discarding = not is_delimiter;
+            }
+            else if (is_delimiter)
+            {
+                input_buffer.commit();
+                ++completed_frames;
+            }
+        }
+
+        /// the main program has read a delimiter from the input buffer.
+        void frame_consumed() volatile
+        {
+            round_robin_detail::critical_section guard;
+            --completed_frames;
         }
 
         /// cancel all appends since the last commit
@@ -213,6 +1133,12 @@ namespace serial
         bool idle;
         round_robin_buffer<output_buffer_size> output_buffer;
         round_robin_buffer<input_buffer_size> input_buffer;
+        round_robin_buffer<descriptor_queue_size, transmit_descriptor> descriptors;
+        transmit_descriptor current;
+        frame_count completed_frames; ///< number of delimiters in the input buffer
+        bool        rx_discarding;    ///< dropping the rest of a frame that did not fit
+        bool        filtering;        ///< multi-processor mode: true if listening to node_address
+        uint8_t     node_address;
     };
 }
 #endif /* AVR_UTILITIES_DEVICES_UART_H_ */
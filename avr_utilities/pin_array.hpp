@@ -0,0 +1,202 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_PIN_ARRAY_HPP_
+#define AVR_UTILITIES_PIN_ARRAY_HPP_
+#include "avr_utilities/pin_definitions.hpp"
+
+#if !defined(AVR_UTILITIES_SIMULATION)
+#   include <avr/pgmspace.h>
+#endif
+
+namespace pin_definitions
+{
+    /// One entry in the flash table of a pin_array: the address of the PINx register
+    /// of the port of a pin, and the bit mask of the pin in that port.
+    struct pin_array_entry
+    {
+        uint16_t pin_address;
+        uint8_t  mask;
+    };
+
+    /// DDRx and PORTx are at fixed offsets from PINx on most AVRs. pin_array relies on this,
+    /// so that one table entry suffices for all registers, and checks it at compile time
+    /// for every pin in the array.
+    static const uint8_t ddr_offset  = 1;
+    static const uint8_t port_offset = 2;
+
+    namespace detail
+    {
+        /// meta function that builds a cons list out of a parameter pack.
+        template< typename... pins>
+        struct pack_to_cons;
+
+        template< typename head, typename... tail>
+        struct pack_to_cons< head, tail...>
+        {
+            typedef cons< head, typename pack_to_cons< tail...>::type> type;
+        };
+
+        template<>
+        struct pack_to_cons<>
+        {
+            typedef empty_list type;
+        };
+
+        /// meta function that checks whether the registers of all given pins are laid out
+        /// as PINx, DDRx, PORTx.
+        template< typename... pins>
+        struct has_standard_layout;
+
+        template< typename head, typename... tail>
+        struct has_standard_layout< head, tail...>
+        {
+            typedef port_traits< head::port> traits;
+            static const bool value =
+                    traits::ddr_address  == traits::pin_address + ddr_offset
+                and traits::port_address == traits::pin_address + port_offset
+                and has_standard_layout< tail...>::value;
+        };
+
+        template<>
+        struct has_standard_layout<>
+        {
+            static const bool value = true;
+        };
+
+        inline register_reference register_at( uint16_t address)
+        {
+            return _MMIO_BYTE( address);
+        }
+    }
+
+    /// An array of pins that can be indexed at run time, e.g.
+    /// @code
+    ///     typedef pin_array< PIN_TYPE( B, 0), PIN_TYPE( D, 5), PIN_TYPE( C, 2)> columns_type;
+    ///     columns_type columns;
+    ///
+    ///     make_output( columns); // all pins at once, as with any list of pins
+    ///     for (uint8_t column = 0; column < columns_type::size; ++column)
+    ///     {
+    ///         set( columns, column);
+    ///         ...
+    ///         reset( columns, column);
+    ///     }
+    /// @endcode
+    /// The register address and bit mask of each pin are stored in a table in flash memory
+    /// that is generated at compile time, so an indexed operation costs a table lookup
+    /// and one register access instead of a chain of comparisons.
+    /// A pin_array is also a list of pins, so all functions that take a list of pins, like
+    /// make_output(), write() and read(), accept a pin_array as well. For those functions the
+    /// first pin of the array corresponds with the least significant bit.
+    template< typename... pins>
+    struct pin_array
+    {
+        static_assert( sizeof...(pins) > 0, "a pin_array needs at least one pin");
+        static_assert( detail::has_standard_layout< pins...>::value,
+                "pin_array requires the DDRx and PORTx registers to directly follow PINx");
+
+        static const uint8_t size = sizeof...(pins);
+        typedef typename detail::pack_to_cons< pins...>::type as_cons;
+
+        static const pin_array_entry table[sizeof...(pins)];
+    };
+
+    template< typename... pins>
+    const pin_array_entry pin_array< pins...>::table[sizeof...(pins)] PROGMEM = {
+            { port_traits< pins::port>::pin_address, pins::mask}...
+    };
+
+    namespace detail
+    {
+        /// Look up the register address and mask of a pin in the table of a pin_array.
+        /// This returns the address of the PINx register.
+        template< typename... pins>
+        inline uint16_t lookup( const pin_array< pins...> &, uint8_t index, uint8_t &mask)
+        {
+            const pin_array_entry *entry = &pin_array< pins...>::table[index];
+            mask = pgm_read_byte( &entry->mask);
+            return pgm_read_word( &entry->pin_address);
+        }
+    }
+
+    /// set the pin with the given index to 1.
+    /// Note that, unlike set() for pins that are known at compile time, this is always a
+    /// read-modify-write and therefore not atomic.
+    template< typename... pins>
+    inline void set( const pin_array< pins...> &array, uint8_t index)
+    {
+        uint8_t mask;
+        const uint16_t address = detail::lookup( array, index, mask);
+        detail::register_at( address + port_offset) |= mask;
+    }
+
+    /// reset the pin with the given index to 0.
+    template< typename... pins>
+    inline void reset( const pin_array< pins...> &array, uint8_t index)
+    {
+        uint8_t mask;
+        const uint16_t address = detail::lookup( array, index, mask);
+        detail::register_at( address + port_offset) &= ~mask;
+    }
+
+    /// clear() is an alias for reset().
+    template< typename... pins>
+    inline void clear( const pin_array< pins...> &array, uint8_t index)
+    {
+        reset( array, index);
+    }
+
+    /// toggle the pin with the given index. This is a single write to the PINx register.
+    template< typename... pins>
+    inline void toggle( const pin_array< pins...> &array, uint8_t index)
+    {
+        uint8_t mask;
+        const uint16_t address = detail::lookup( array, index, mask);
+        detail::register_at( address) = mask;
+    }
+
+    /// write a value to the pin with the given index.
+    template< typename... pins>
+    inline void write( const pin_array< pins...> &array, uint8_t index, bool value)
+    {
+        uint8_t mask;
+        const uint16_t address = detail::lookup( array, index, mask);
+        register_reference port = detail::register_at( address + port_offset);
+        if (value) port |= mask;
+        else port &= ~mask;
+    }
+
+    /// return true iff the pin with the given index is high.
+    template< typename... pins>
+    inline bool read( const pin_array< pins...> &array, uint8_t index)
+    {
+        uint8_t mask;
+        const uint16_t address = detail::lookup( array, index, mask);
+        return (detail::register_at( address) & mask) != 0;
+    }
+
+    /// make the pin with the given index an output.
+    template< typename... pins>
+    inline void make_output( const pin_array< pins...> &array, uint8_t index)
+    {
+        uint8_t mask;
+        const uint16_t address = detail::lookup( array, index, mask);
+        detail::register_at( address + ddr_offset) |= mask;
+    }
+
+    /// make the pin with the given index an input.
+    template< typename... pins>
+    inline void make_input( const pin_array< pins...> &array, uint8_t index)
+    {
+        uint8_t mask;
+        const uint16_t address = detail::lookup( array, index, mask);
+        detail::register_at( address + ddr_offset) &= ~mask;
+    }
+}
+
+#endif /* AVR_UTILITIES_PIN_ARRAY_HPP_ */
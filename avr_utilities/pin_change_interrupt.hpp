@@ -0,0 +1,243 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_PIN_CHANGE_INTERRUPT_HPP_
+#define AVR_UTILITIES_PIN_CHANGE_INTERRUPT_HPP_
+#include "avr_utilities/pin_definitions.hpp"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/**
+ * Pin change interrupt dispatcher.
+ *
+ * Given a list of (pin, handler function) pairs, the dispatcher configures the
+ * PCMSKx and PCICR registers and provides the bodies of the PCINTx interrupt
+ * handlers. Every interrupt handler reads the input port once, compares it with the
+ * previous state of that port and calls the handlers of only those pins that changed.
+ * Handler functions receive the new level of their pin.
+ *
+ * Example:
+ * \code
+ * PIN_TYPE( B, 0) button;
+ * PIN_TYPE( D, 3) encoder;
+ *
+ * void on_button( bool level) {...}
+ * void on_encoder( bool level) {...}
+ *
+ * typedef pin_definitions::cons<
+ *          pin_change::handler< PIN_TYPE( B, 0), on_button>,
+ *          pin_definitions::cons<
+ *          pin_change::handler< PIN_TYPE( D, 3), on_encoder> > > handlers;
+ *
+ * IMPLEMENT_PIN_CHANGE_INTERRUPTS( handlers)
+ *
+ * int main()
+ * {
+ *     make_input( button | encoder);
+ *     pin_change::dispatcher< handlers>::init();
+ *     sei();
+ *     ...
+ * }
+ * \endcode
+ *
+ * Only ports of which all pins map to one pin change group, with PCINT bit n
+ * corresponding to bit n of the port, are supported.
+ */
+namespace pin_change
+{
+    /// Associates a pin (or pin group) with a handler function.
+    template< typename pin_type, void (*function)( bool)>
+    struct handler
+    {
+        static const pin_definitions::PortPlaceholder port = pin_type::port;
+        static const uint8_t mask = pin_type::mask;
+        typedef pin_definitions::cons< handler> as_cons;
+
+        static void call( bool level)
+        {
+            function( level);
+        }
+    };
+
+    namespace detail
+    {
+        using pin_definitions::PortPlaceholder;
+
+        /// traits that for a pin change group give the port, the PCMSKx register and
+        /// the PCIEx and PCIFx bits.
+        template< uint8_t group>
+        struct group_traits;
+
+        /// meta function that returns the pin change group of a port.
+        /// If you get a compile error about an incomplete type here, the port that you
+        /// are using does not support pin change interrupts on your mcu, or the mcu is not
+        /// known in pin_change_interrupt.hpp.
+        template< PortPlaceholder port>
+        struct port_group;
+
+#define DECLARE_PIN_CHANGE_GROUP( group_, p_)                                   \
+        template<>                                                              \
+        struct group_traits< group_>                                            \
+        {                                                                       \
+            static const PortPlaceholder port = pin_definitions::port_##p_;     \
+            static const uint8_t enable_bit = PCIE##group_;                     \
+            static const uint8_t flag_bit   = PCIF##group_;                     \
+            static volatile uint8_t &mask_register() { return PCMSK##group_;}   \
+        };                                                                      \
+        template<>                                                              \
+        struct port_group< pin_definitions::port_##p_>                          \
+        {                                                                       \
+            static const uint8_t value = group_;                                \
+        };                                                                      \
+        /**/
+
+#if defined(__AVR_ATmega48__) || defined(__AVR_ATmega48A__) || defined(__AVR_ATmega48P__) || defined(__AVR_ATmega48PA__) \
+    || defined(__AVR_ATmega88__) || defined(__AVR_ATmega88A__) || defined(__AVR_ATmega88P__) || defined(__AVR_ATmega88PA__) \
+    || defined(__AVR_ATmega168__) || defined(__AVR_ATmega168A__) || defined(__AVR_ATmega168P__) || defined(__AVR_ATmega168PA__) \
+    || defined(__AVR_ATmega328__) || defined(__AVR_ATmega328P__)
+        DECLARE_PIN_CHANGE_GROUP( 0, B)
+        DECLARE_PIN_CHANGE_GROUP( 1, C)
+        DECLARE_PIN_CHANGE_GROUP( 2, D)
+#       define PIN_CHANGE_INTERRUPTS_( handlers_) \
+            PIN_CHANGE_INTERRUPT_( 0, handlers_)  \
+            PIN_CHANGE_INTERRUPT_( 1, handlers_)  \
+            PIN_CHANGE_INTERRUPT_( 2, handlers_)
+#elif defined(__AVR_ATmega164A__) || defined(__AVR_ATmega164P__) || defined(__AVR_ATmega164PA__) \
+    || defined(__AVR_ATmega324A__) || defined(__AVR_ATmega324P__) || defined(__AVR_ATmega324PA__) \
+    || defined(__AVR_ATmega644__) || defined(__AVR_ATmega644A__) || defined(__AVR_ATmega644P__) || defined(__AVR_ATmega644PA__) \
+    || defined(__AVR_ATmega1284__) || defined(__AVR_ATmega1284P__)
+        DECLARE_PIN_CHANGE_GROUP( 0, A)
+        DECLARE_PIN_CHANGE_GROUP( 1, B)
+        DECLARE_PIN_CHANGE_GROUP( 2, C)
+        DECLARE_PIN_CHANGE_GROUP( 3, D)
+#       define PIN_CHANGE_INTERRUPTS_( handlers_) \
+            PIN_CHANGE_INTERRUPT_( 0, handlers_)  \
+            PIN_CHANGE_INTERRUPT_( 1, handlers_)  \
+            PIN_CHANGE_INTERRUPT_( 2, handlers_)  \
+            PIN_CHANGE_INTERRUPT_( 3, handlers_)
+#elif defined(__AVR_ATmega640__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega1281__) \
+    || defined(__AVR_ATmega2560__) || defined(__AVR_ATmega2561__)
+        // group 1 consists of PE0 and PJ0-PJ6 and is not supported.
+        DECLARE_PIN_CHANGE_GROUP( 0, B)
+        DECLARE_PIN_CHANGE_GROUP( 2, K)
+#       define PIN_CHANGE_INTERRUPTS_( handlers_) \
+            PIN_CHANGE_INTERRUPT_( 0, handlers_)  \
+            PIN_CHANGE_INTERRUPT_( 2, handlers_)
+#else
+#       define PIN_CHANGE_INTERRUPTS_( handlers_)
+#endif
+
+#undef DECLARE_PIN_CHANGE_GROUP
+
+        /// call the handlers in 'list' that are on 'port' and whose pins are in 'changed'.
+        template< typename list, PortPlaceholder port>
+        struct dispatch
+        {
+            typedef typename list::head head;
+            static inline void call( uint8_t current, uint8_t changed) __attribute__((always_inline))
+            {
+                if (pin_definitions::is_same_port< port, head::port>::value && (changed & head::mask))
+                {
+                    head::call( (current & head::mask) != 0);
+                }
+                dispatch< typename list::tail, port>::call( current, changed);
+            }
+        };
+
+        template< PortPlaceholder port>
+        struct dispatch< pin_definitions::empty_list, port>
+        {
+            static inline void call( uint8_t, uint8_t) __attribute__((always_inline))
+            {
+            }
+        };
+
+        /// enable the pin change interrupts for all ports in 'remaining'.
+        template< typename list, typename remaining, typename states>
+        struct enable_ports
+        {
+            static const PortPlaceholder port = remaining::head::port;
+            typedef group_traits< port_group< port>::value> traits;
+
+            static inline void enable( states &previous) __attribute__((always_inline))
+            {
+                previous[port_group< port>::value] = pin_definitions::get_port< port>( pin_definitions::tag_pin());
+                traits::mask_register() |= pin_definitions::mask_for_port< port, list>::value;
+                PCIFR = _BV( traits::flag_bit);
+                PCICR |= _BV( traits::enable_bit);
+
+                enable_ports<
+                    list,
+                    typename pin_definitions::remove_port< port, typename remaining::tail>::type,
+                    states>::enable( previous);
+            }
+        };
+
+        template< typename list, typename states>
+        struct enable_ports< list, pin_definitions::empty_list, states>
+        {
+            static inline void enable( states &) __attribute__((always_inline))
+            {
+            }
+        };
+    }
+
+    /// The dispatcher for a list of handlers.
+    template< typename handlers>
+    struct dispatcher
+    {
+        typedef typename handlers::as_cons list;
+
+        /// configure the pin change interrupts for all pins in the handler list.
+        /// This does not enable interrupts globally.
+        static void init()
+        {
+            detail::enable_ports< list, list, uint8_t[group_count]>::enable( previous);
+        }
+
+        /// body of the interrupt handler for one pin change group.
+        /// Normally this is called by the interrupt handlers that the macro
+        /// IMPLEMENT_PIN_CHANGE_INTERRUPTS creates.
+        template< uint8_t group>
+        static inline PIN_DEF_ALWAYS_INLINE void on_interrupt()
+        {
+            typedef detail::group_traits< group> traits;
+            const uint8_t current = pin_definitions::get_port< traits::port>( pin_definitions::tag_pin());
+            const uint8_t changed =
+                    (current ^ previous[group]) & pin_definitions::mask_for_port< traits::port, list>::value;
+            previous[group] = current;
+            detail::dispatch< list, traits::port>::call( current, changed);
+        }
+
+    private:
+        static const uint8_t group_count = 4;
+        static uint8_t previous[group_count];
+    };
+
+    template< typename handlers>
+    uint8_t dispatcher< handlers>::previous[dispatcher< handlers>::group_count];
+}
+
+#define PIN_CHANGE_INTERRUPT_( group_, handlers_)                        \
+    ISR( PCINT##group_##_vect)                                          \
+    {                                                                   \
+        pin_change::dispatcher< handlers_>::on_interrupt< group_>();    \
+    }                                                                   \
+    /**/
+
+/**
+ * Use this macro to let a pin change dispatcher handle all pin change interrupts.
+ * This defines the interrupt handlers for all supported pin change groups of the mcu, so
+ * no other code should define PCINTx interrupt handlers.
+ * handlers_ must be a single type name, use a typedef for lists.
+ */
+#define IMPLEMENT_PIN_CHANGE_INTERRUPTS( handlers_)     \
+    PIN_CHANGE_INTERRUPTS_( handlers_)                  \
+    /**/
+
+#endif /* AVR_UTILITIES_PIN_CHANGE_INTERRUPT_HPP_ */
@@ -10,13 +10,26 @@
 ///
 /// The templates allow the code to be as efficient as handwritten statements, at the cost of
 /// some compilation time.
+///
+/// Pins can be combined into lists with operator|() or list_of(). In both, the right-most
+/// pin is the head of the list and receives the least significant bit in the write() and
+/// read() functions for lists, e.g. write( d3 | d2 | d1 | d0, 5) sets d2 and d0.
+/// Note that before write() and read() for lists were added, pin_a | pin_b put pin_a at the
+/// head of the list. Code that depends on the order of the pins in such a list now sees them
+/// in the reverse order. set(), reset() and the other functions that treat all pins of a list
+/// alike are not affected.
 
 #if !defined(PIN_DEFINITIONS_HPP_)
 #define PIN_DEFINITIONS_HPP_
 
 
 #include <stdint.h>  // including a std C header in an obvious C++ header file. hmm.
+#if defined(AVR_UTILITIES_SIMULATION)
+#include "avr_utilities/simulation/registers.hpp"
+#else
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#endif
 
 #define PIN_DEF_ALWAYS_INLINE __attribute__((always_inline))
 
@@ -30,7 +43,12 @@ namespace pin_definitions
         port_C,
         port_D,
         port_E,
-        port_F
+        port_F,
+        port_G,
+        port_H,
+        port_J,
+        port_K,
+        port_L
     };
 
     /// tags to help select between port (output port), pin (input port) or
@@ -54,10 +72,19 @@ namespace pin_definitions
         static void get( const T &){}
     };
 
+    /// The type through which registers are accessed. When compiling for a host
+    /// simulation (see simulation/registers.hpp) this is a proxy type that records
+    /// all register accesses.
+#if defined(AVR_UTILITIES_SIMULATION)
+    typedef simulation::register_ref register_reference;
+#else
+    typedef volatile uint8_t &register_reference;
+#endif
+
     template< PortPlaceholder port>
     struct port_type
     {
-        typedef volatile uint8_t &type;
+        typedef register_reference type;
     };
 
     template<>
@@ -66,13 +93,39 @@ namespace pin_definitions
         typedef null_port type;
     };
 
+// While declaring the port traits, the avr-libc register macros are redefined to
+// yield the plain memory address of a register instead of the register itself. This
+// way, the register addresses become compile time constants that can be used
+// to select the cheapest instructions for each register.
+// The PINx, DDRx and PORTx registers of a port are usually consecutive, but not on every
+// AVR: on the ATmega64/128, for example, PINF is in I/O space while DDRF and PORTF are
+// in extended I/O space. The flags below therefore hold only if they are true for all
+// three registers.
+// bit_addressable: the registers can be manipulated with the atomic SBI and CBI instructions.
+// io_addressable:  the registers can be accessed with IN and OUT. Registers that are not
+//                  io_addressable (like ports H-L on the ATmega2560) are only reachable
+//                  through LDS and STS.
+#pragma push_macro("_SFR_IO8")
+#pragma push_macro("_SFR_MEM8")
+#undef _SFR_IO8
+#undef _SFR_MEM8
+#define _SFR_IO8( io_addr_) ((io_addr_) + __SFR_OFFSET)
+#define _SFR_MEM8( mem_addr_) (mem_addr_)
+
 #define DECLARE_PORT_TRAITS( p_)                                    \
         template<>                                                  \
         struct port_traits<port_##p_>                               \
         {                                                           \
-            static volatile uint8_t &get( const tag_port &) { return PORT##p_;} \
-            static volatile uint8_t &get( const tag_pin  &) { return PIN##p_; } \
-            static volatile uint8_t &get( const tag_ddr  &) { return DDR##p_; } \
+            static const uint16_t port_address = PORT##p_;          \
+            static const uint16_t pin_address  = PIN##p_;           \
+            static const uint16_t ddr_address  = DDR##p_;           \
+            static const uint16_t max_pin_ddr_address = pin_address > ddr_address ? pin_address : ddr_address; \
+            static const uint16_t highest_address = port_address > max_pin_ddr_address ? port_address : max_pin_ddr_address; \
+            static const bool bit_addressable = highest_address < 0x20 + __SFR_OFFSET; \
+            static const bool io_addressable  = highest_address < 0x40 + __SFR_OFFSET; \
+            static register_reference get( const tag_port &) { return _MMIO_BYTE( port_address);} \
+            static register_reference get( const tag_pin  &) { return _MMIO_BYTE( pin_address); } \
+            static register_reference get( const tag_ddr  &) { return _MMIO_BYTE( ddr_address); } \
         };                                                          \
         /**/
 
@@ -95,7 +148,24 @@ namespace pin_definitions
 #if defined(PORTF)
     DECLARE_PORT_TRAITS( F)
 #endif
+#if defined(PORTG)
+    DECLARE_PORT_TRAITS( G)
+#endif
+#if defined(PORTH)
+    DECLARE_PORT_TRAITS( H)
+#endif
+#if defined(PORTJ)
+    DECLARE_PORT_TRAITS( J)
+#endif
+#if defined(PORTK)
+    DECLARE_PORT_TRAITS( K)
+#endif
+#if defined(PORTL)
+    DECLARE_PORT_TRAITS( L)
+#endif
 
+#pragma pop_macro("_SFR_MEM8")
+#pragma pop_macro("_SFR_IO8")
 
 /// specialisation for null-port. Will always return the null-port type.
 template<>
@@ -136,6 +206,7 @@ struct pin_definition
     static const uint8_t            bit  = bit_;
     static const uint8_t            mask = 1 << bit_;
     static const uint8_t 			shift = bit_;
+    static const uint8_t            width = 1;
     typedef cons< pin_definition< port_, bit_>, empty_list> as_cons;
 };
 
@@ -151,6 +222,7 @@ struct pin_group
     static const PortPlaceholder    port = port_;
     static const uint8_t            mask = (0xff >> (8 - bits)) << first_bit;
     static const uint8_t            shift = first_bit;
+    static const uint8_t            width = bits;
 
     typedef cons< pin_group< port_, first_bit, bits>, empty_list> as_cons;
 };
@@ -160,10 +232,10 @@ struct pin_group
 // the following functions are a very lightweight version of boost.mpl
 
 /// true-value for if_ metafunction
-struct true_type { typedef true_type type;};
+struct true_type { typedef true_type type; static const bool value = true;};
 
 /// false-value for if_ metafunction
-struct false_type { typedef false_type type;};
+struct false_type { typedef false_type type; static const bool value = false;};
 
 
 
@@ -187,6 +259,19 @@ struct and_ : false_type {};
 template<>
 struct and_<true_type, true_type> : true_type {};
 
+template< typename condition>
+struct not_ : false_type {};
+
+template<>
+struct not_<false_type> : true_type {};
+
+/// meta function that converts a boolean constant into true_type or false_type
+template< bool condition>
+struct bool_ : false_type {};
+
+template<>
+struct bool_<true> : true_type {};
+
 /// utility template to employ SFINAE to add or remove
 /// certain functions from an overload set.
 template< typename condition, typename t = void>
@@ -216,6 +301,14 @@ template< PortPlaceholder port_,
 struct is_pin_or_pin_group< pin_group< port_, first_bit, bits> >
     : true_type {};
 
+/// meta-function that tells us if a given type is a single pin.
+template <typename T>
+struct is_single_pin : false_type {};
+
+template< PortPlaceholder port_, uint8_t bit_>
+struct is_single_pin< pin_definition<port_, bit_> >
+    : true_type {};
+
 
 /// meta-function that returns true if two ports are equal
 template< PortPlaceholder left, PortPlaceholder right>
@@ -224,6 +317,10 @@ struct is_same_port : false_type {};
 template< PortPlaceholder holder>
 struct is_same_port< holder, holder> : true_type {};
 
+/// meta-function that returns true if exactly one bit is set in the given mask.
+template< uint8_t mask>
+struct is_single_bit : bool_< (mask != 0 && (mask & (mask - 1)) == 0)> {};
+
 struct null_mask
 {
     static const uint8_t mask = 0;
@@ -287,16 +384,19 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
     ///    pindef0 | pindef1 | pindef2...
     /// enable_if is used to make sure each argument is either a pin or a
     /// pin group.
+    /// Just like with list_of(), the right-most pin becomes the head of the list.
+    /// This order changed when write() and read() for lists were added, see the
+    /// top of this file.
     template< typename left_type, typename right_type>
     typename enable_if<
         typename and_<
             typename is_pin_or_pin_group<left_type>::type,
             typename is_pin_or_pin_group<right_type>::type
         >::type,
-        cons<left_type, cons<right_type> >
+        cons<right_type, cons<left_type> >
     >::type operator|( const left_type &, const right_type &)
     {
-        return cons<left_type, cons<right_type> >();
+        return cons<right_type, cons<left_type> >();
     }
 
     /// this definition of operator|() allows us to combine a list of pins
@@ -335,6 +435,21 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
         typedef empty_list type;
     };
 
+    /// template meta function that creates one list out of two lists.
+    /// The left argument may also be a single pin, pin group or list builder.
+    template< typename left, typename right>
+    struct concatenate_cons
+    {
+        typedef typename left::as_cons list;
+        typedef cons< typename list::head, typename concatenate_cons< typename list::tail, right>::type> type;
+    };
+
+    template< typename right>
+    struct concatenate_cons< empty_list, right>
+    {
+        typedef right type;
+    };
+
     namespace detail
     {
         template< typename operation, typename port_tag>
@@ -361,6 +476,14 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
                 // now remove all elements for this port from 'list' and recurse.
                 for_each_port_operator< typename remove_port< port, typename list::tail>::type, operation, port_tag>::operate();
             }
+
+            /// Variant of operate() for operations that carry state or that need to know the port they
+            /// are operating on. For each port, this calls op.apply<port, mask>( register).
+            static inline void operate( const operation &op) __attribute__((always_inline))
+            {
+                op.template apply< port, mask_for_port< port, list>::value>( get_port<port>( port_tag()));
+                for_each_port_operator< typename remove_port< port, typename list::tail>::type, operation, port_tag>::operate( op);
+            }
         };
 
         /// specialization of the for_each_port_operator meta function for empty lists.
@@ -371,15 +494,136 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
             {
                 // do nothing for the empty list...
             }
+
+            static inline void operate( const operation &) __attribute__((always_inline))
+            {
+                // do nothing for the empty list...
+            }
         };
 
+        /// Maps the bits of a value onto the pins of one port.
+        /// The head of the list receives the least significant bit(s) of the value, the next element
+        /// of the list the bit(s) after that, etc. The bit offset of the head of the list is given by
+        /// 'offset'. All shifts and masks are compile time constants and any list element that is not
+        /// on 'port' does not generate any code.
+        template< PortPlaceholder port, typename list, uint8_t offset = 0>
+        struct port_bits
+        {
+            typedef typename list::head head;
+            typedef port_bits< port, typename list::tail, offset + head::width> next;
+
+            template< typename value_type>
+            static inline PIN_DEF_ALWAYS_INLINE uint8_t scatter( value_type value)
+            {
+                return
+                    (is_same_port< port, head::port>::value ?
+                        static_cast<uint8_t>(((value >> offset) << head::shift) & head::mask) : 0)
+                    | next::scatter( value);
+            }
+
+            /// inverse of scatter(): extract the bits of the pins on 'port' from a sample of that port.
+            template< typename value_type>
+            static inline PIN_DEF_ALWAYS_INLINE value_type gather( uint8_t sample)
+            {
+                return
+                    (is_same_port< port, head::port>::value ?
+                        static_cast<value_type>( static_cast<value_type>( (sample & head::mask) >> head::shift) << offset) : 0)
+                    | next::template gather< value_type>( sample);
+            }
+        };
+
+        template< PortPlaceholder port, uint8_t offset>
+        struct port_bits< port, empty_list, offset>
+        {
+            template< typename value_type>
+            static inline PIN_DEF_ALWAYS_INLINE uint8_t scatter( value_type)
+            {
+                return 0;
+            }
+
+            template< typename value_type>
+            static inline PIN_DEF_ALWAYS_INLINE value_type gather( uint8_t)
+            {
+                return 0;
+            }
+        };
+
+        /// meta function that calculates the total number of bits in a list of
+        /// pins and pin groups.
+        template< typename list>
+        struct list_width
+        {
+            static const uint8_t value = list::head::width + list_width< typename list::tail>::value;
+        };
+
+        template<>
+        struct list_width< empty_list>
+        {
+            static const uint8_t value = 0;
+        };
+
+        /// meta function that returns the smallest unsigned integer type that can hold
+        /// the values of all bits of a list of pins.
+        template< typename list>
+        struct list_value_type
+        {
+            typedef typename if_<
+                    typename bool_< (list_width< list>::value <= 8)>::type,
+                    uint8_t,
+                    typename if_<
+                        typename bool_< (list_width< list>::value <= 16)>::type,
+                        uint16_t,
+                        uint32_t
+                        >::type
+                    >::type type;
+        };
+
+        inline uint8_t sample( register_reference reg)
+        {
+            return reg;
+        }
+
+        inline uint8_t sample( const null_port &)
+        {
+            return 0;
+        }
+
+        /// Reads the input registers of all ports in 'remaining' and assembles the bits of
+        /// the pins in 'list' into one value.
+        /// Each input register is read exactly once, in the order in which the ports first appear
+        /// in the list. All register reads are done before any bits are combined, which keeps the
+        /// time between the samples as short as possible.
+        template< typename list, typename remaining = list>
+        struct gather_ports
+        {
+            static const PortPlaceholder port = remaining::head::port;
+            typedef gather_ports< list, typename remove_port< port, typename remaining::tail>::type> next;
+
+            template< typename value_type>
+            static inline PIN_DEF_ALWAYS_INLINE value_type read()
+            {
+                const uint8_t value = sample( get_port<port>( tag_pin()));
+                const value_type others = next::template read< value_type>();
+                return others | port_bits< port, list>::template gather< value_type>( value);
+            }
+        };
+
+        template< typename list>
+        struct gather_ports< list, empty_list>
+        {
+            template< typename value_type>
+            static inline PIN_DEF_ALWAYS_INLINE value_type read()
+            {
+                return 0;
+            }
+        };
     }
 
     /// This operator will assign the value to the given register.
     /// operator to be used with for_each_port_operator
-    struct assign
+    struct assign_bits
     {
-        void operator()( volatile uint8_t &reg, uint8_t value) const
+        void operator()( register_reference reg, uint8_t value) const
         {
             reg = value;
         }
@@ -392,11 +636,16 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
 
     /// This operator will logical-or the value with the given register.
     /// operator to be used with for_each_port_operator
+    /// The value is always a compile time constant, so the choice between the
+    /// two forms below is made by the compiler. A single bit in a bit addressable
+    /// register compiles to SBI.
     struct set_bits
     {
-        void operator()( volatile uint8_t &reg, uint8_t value) const
+        void operator()( register_reference reg, uint8_t value) const
         {
-            reg |= value;
+            // if all bits are set, there's no need to read the register first.
+            if (value == 0xff) reg = 0xff;
+            else reg |= value;
         }
 
         void operator()( const null_port &, uint8_t ) const
@@ -409,9 +658,11 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
     /// operator to be used with for_each_port_operator
     struct reset_bits
     {
-        void operator()( volatile uint8_t &reg, uint8_t value) const
+        void operator()( register_reference reg, uint8_t value) const
         {
-            reg &= ~value;
+            // if all bits are reset, there's no need to read the register first.
+            if (value == 0xff) reg = 0;
+            else reg &= ~value;
         }
 
         void operator()( const null_port &, uint8_t ) const
@@ -420,6 +671,114 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
         }
     };
 
+    /// This operator will write the bits of a value to the pins of a list that are in the given
+    /// register, leaving all other bits in the register untouched.
+    /// operator to be used with the stateful form of for_each_port_operator
+    template< typename list, typename value_type>
+    struct scatter_bits
+    {
+        explicit scatter_bits( value_type value) : value( value) {}
+
+        template< PortPlaceholder port, uint8_t mask>
+        void apply( register_reference reg) const
+        {
+            reg = (reg & ~mask) | detail::port_bits< port, list>::scatter( value);
+        }
+
+        template< PortPlaceholder port, uint8_t mask>
+        void apply( const null_port &) const
+        {
+            // do nothing;
+        }
+
+        value_type value;
+    };
+
+    /// This operator will set the bits of the pins in 'high_list' and reset the bits of the pins in
+    /// 'low_list' in a single write to the given register.
+    /// operator to be used with the stateful form of for_each_port_operator
+    template< typename high_list, typename low_list>
+    struct set_and_reset_bits
+    {
+        template< PortPlaceholder port, uint8_t mask>
+        void apply( register_reference reg) const
+        {
+            reg = (reg & ~mask_for_port< port, low_list>::value) | mask_for_port< port, high_list>::value;
+        }
+
+        template< PortPlaceholder port, uint8_t mask>
+        void apply( const null_port &) const
+        {
+            // do nothing;
+        }
+    };
+
+    /// This operator wraps set_bits or reset_bits and makes the operation atomic with respect to
+    /// interrupts.
+    /// If only one bit of a port in low I/O space changes, the operation compiles to a single SBI or
+    /// CBI instruction, which is atomic by itself. In all other cases the read-modify-write is
+    /// performed with interrupts disabled, after which the status register is restored.
+    /// operator to be used with the stateful form of for_each_port_operator
+    template< typename operation>
+    struct atomic_bits
+    {
+        template< PortPlaceholder port, uint8_t mask>
+        void apply( register_reference reg) const
+        {
+            execute( reg, mask,
+                    typename and_<
+                        typename is_single_bit< mask>::type,
+                        typename bool_< port_traits< port>::bit_addressable>::type
+                    >::type());
+        }
+
+        template< PortPlaceholder port, uint8_t mask>
+        void apply( const null_port &) const
+        {
+            // do nothing;
+        }
+
+    private:
+        static void execute( register_reference reg, uint8_t mask, const true_type &)
+        {
+            operation()( reg, mask);
+        }
+
+        static void execute( register_reference reg, uint8_t mask, const false_type &)
+        {
+            const uint8_t sreg = SREG;
+            cli();
+            operation()( reg, mask);
+            SREG = sreg;
+        }
+    };
+
+    /// This operator performs another (stateful) operator with interrupts disabled and restores the
+    /// status register afterwards.
+    /// operator to be used with the stateful form of for_each_port_operator
+    template< typename operation>
+    struct interrupt_guarded
+    {
+        explicit interrupt_guarded( const operation &op) : op( op) {}
+
+        template< PortPlaceholder port, uint8_t mask>
+        void apply( register_reference reg) const
+        {
+            const uint8_t sreg = SREG;
+            cli();
+            op.template apply< port, mask>( reg);
+            SREG = sreg;
+        }
+
+        template< PortPlaceholder port, uint8_t mask>
+        void apply( const null_port &) const
+        {
+            // do nothing;
+        }
+
+        operation op;
+    };
+
     // the following functions use pin definitions to perform common tasks
 
     /// initialize all ports of the given pin definitions, turning all given pins to output and making all
@@ -430,7 +789,7 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
     template< typename list_builder>
     inline extern void init_as_output( const list_builder &)
     {
-        detail::for_each_port_operator< typename list_builder::as_cons, assign, tag_ddr>::operate();
+        detail::for_each_port_operator< typename list_builder::as_cons, assign_bits, tag_ddr>::operate();
     }
 
     /// make the given pins outputs. This does not affect other pins on the same ports.
@@ -450,6 +809,9 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
     }
 
     /// set the given bits to 1, this changes the output ports
+    /// A single pin on a bit addressable port compiles to one SBI instruction. Multiple pins,
+    /// or pins on ports that are not bit addressable, result in a read-modify-write of the
+    /// port register. Use atomic_set() if interrupt handlers change pins of the same port.
     /// See also init_as_output.
     template< typename list_builder>
     inline PIN_DEF_ALWAYS_INLINE void set( const list_builder &)
@@ -464,7 +826,7 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
     template< typename list_builder>
     inline PIN_DEF_ALWAYS_INLINE void toggle( const list_builder &)
     {
-        detail::for_each_port_operator< typename list_builder::as_cons, assign, tag_pin>::operate();
+        detail::for_each_port_operator< typename list_builder::as_cons, assign_bits, tag_pin>::operate();
     }
 
     /// resets the given bits to zero.
@@ -482,13 +844,39 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
         reset( pins);
     }
 
+    /// set the pins of the first argument to 1 and reset the pins of the second argument to zero.
+    /// Both arguments can be pins, pin groups or lists of those, possibly spread over several ports.
+    /// Every port that is mentioned in either argument receives exactly one read-modify-write,
+    /// so there is no intermediate state in which only some of the pins on a port have changed.
+    /// If a pin appears in both arguments, it will be set.
+    template< typename high_builder, typename low_builder>
+    inline PIN_DEF_ALWAYS_INLINE void assign( const high_builder &, const low_builder &)
+    {
+        typedef typename high_builder::as_cons high_list;
+        typedef typename low_builder::as_cons  low_list;
+        typedef set_and_reset_bits< high_list, low_list> operation;
+        detail::for_each_port_operator<
+            typename concatenate_cons< high_list, low_list>::type,
+            operation,
+            tag_port>::operate( operation());
+    }
+
     /// write a value to the given output pin or pin-group.
     template< typename pins_type>
-    inline void write( const pins_type &, uint8_t value)
+    inline typename enable_if< typename is_pin_or_pin_group< pins_type>::type>::type
+    write( const pins_type &, uint8_t value)
     {
         uint8_t shifted = (value << pins_type::shift) & pins_type::mask;
-        volatile uint8_t &port = get_port<pins_type::port>( tag_port());
-        port = (port & ~pins_type::mask) | shifted;
+        register_reference port = get_port<pins_type::port>( tag_port());
+        if (pins_type::mask == 0xff)
+        {
+            // the group covers the complete port, no need to read it.
+            port = shifted;
+        }
+        else
+        {
+            port = (port & ~pins_type::mask) | shifted;
+        }
     }
 
     /// overload of the write function for single pins.
@@ -500,9 +888,76 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
         else reset(pin);
     }
 
+    /// write a value to a list of pins and pin groups that may be spread over several ports.
+    /// The last pin in the list receives the least significant bit, so that a list can be written
+    /// down like a binary number:
+    /// @code
+    ///     write( d3 | d2 | d1 | d0, value); // d0 receives bit 0 of value, d3 receives bit 3.
+    /// @endcode
+    /// A pin group takes as many bits of the value as it is wide.
+    /// This performs exactly one read-modify-write for each port in the list.
+    template< typename list_builder, typename value_type>
+    inline PIN_DEF_ALWAYS_INLINE
+    typename enable_if< typename not_< typename is_pin_or_pin_group< list_builder>::type>::type>::type
+    write( const list_builder &, value_type value)
+    {
+        typedef typename list_builder::as_cons list;
+        detail::for_each_port_operator< list, scatter_bits< list, value_type>, tag_port>::operate(
+                scatter_bits< list, value_type>( value));
+    }
+
+    /// set the given output pins atomically, so that interrupt handlers that change pins on the
+    /// same ports can not interfere.
+    /// For a single pin on a port in low I/O space this is exactly the same as set(). In all other
+    /// cases, interrupts are disabled only for the duration of the read-modify-write of each port.
+    template< typename list_builder>
+    inline PIN_DEF_ALWAYS_INLINE void atomic_set( const list_builder &)
+    {
+        typedef atomic_bits< set_bits> operation;
+        detail::for_each_port_operator< typename list_builder::as_cons, operation, tag_port>::operate( operation());
+    }
+
+    /// reset the given output pins atomically. See atomic_set().
+    template< typename list_builder>
+    inline PIN_DEF_ALWAYS_INLINE void atomic_reset( const list_builder &)
+    {
+        typedef atomic_bits< reset_bits> operation;
+        detail::for_each_port_operator< typename list_builder::as_cons, operation, tag_port>::operate( operation());
+    }
+
+    /// atomic_clear() is an alias for atomic_reset().
+    template< typename list_builder>
+    inline PIN_DEF_ALWAYS_INLINE void atomic_clear( const list_builder &pins)
+    {
+        atomic_reset( pins);
+    }
+
+    /// write a value to a pin group or a list of pins with interrupts disabled during the
+    /// read-modify-write of each port.
+    template< typename list_builder, typename value_type>
+    inline PIN_DEF_ALWAYS_INLINE
+    typename enable_if< typename not_< typename is_single_pin< list_builder>::type>::type>::type
+    atomic_write( const list_builder &, value_type value)
+    {
+        typedef typename list_builder::as_cons list;
+        typedef interrupt_guarded< scatter_bits< list, value_type> > operation;
+        detail::for_each_port_operator< list, operation, tag_port>::operate(
+                operation( scatter_bits< list, value_type>( value)));
+    }
+
+    /// overload of atomic_write for single pins, which can use the SBI and CBI instructions.
+    /// Any non-zero value sets the pin.
+    template< PortPlaceholder port_, uint8_t bit_, typename value_type>
+    inline PIN_DEF_ALWAYS_INLINE void atomic_write( const pin_definition<port_, bit_> pin, value_type value)
+    {
+        if (value) atomic_set( pin);
+        else atomic_reset( pin);
+    }
+
     /// read a value from the given input pin or pin-group
     template< typename pins_type>
-    inline uint8_t read( const pins_type &)
+    inline typename enable_if< typename is_pin_or_pin_group< pins_type>::type, uint8_t>::type
+    read( const pins_type &)
     {
         return (get_port<pins_type::port>( tag_pin()) & pins_type::mask)
                     >> pins_type::shift;
@@ -513,9 +968,26 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
         return 0;
     }
 
+    /// read a value from a list of pins and pin groups that may be spread over several ports.
+    /// This is the inverse of write() for lists: the last pin in the list provides the least
+    /// significant bit of the result.
+    /// The input register of every port in the list is read exactly once. The result type is
+    /// the smallest unsigned integer type that can hold all bits.
+    template< typename list_builder>
+    inline PIN_DEF_ALWAYS_INLINE
+    typename enable_if<
+        typename not_< typename is_pin_or_pin_group< list_builder>::type>::type,
+        typename detail::list_value_type< typename list_builder::as_cons>::type
+    >::type read( const list_builder &)
+    {
+        typedef typename list_builder::as_cons list;
+        return detail::gather_ports< list>::template read< typename detail::list_value_type< list>::type>();
+    }
+
     /// returns true iff at least one of the bits in the pin-definition or pin-group is set.
     template< typename pins_type>
-    inline bool is_set( const pins_type &)
+    inline typename enable_if< typename is_pin_or_pin_group< pins_type>::type, bool>::type
+    is_set( const pins_type &)
     {
         return (get_port<pins_type::port>( tag_pin()) & pins_type::mask) != 0;
     }
@@ -525,6 +997,14 @@ inline typename port_type<port>::type get_port( const port_tag &tag)
         return false;
     }
 
+    /// returns true iff at least one of the pins in a list of pins and pin groups is set.
+    template< typename list_builder>
+    inline typename enable_if< typename not_< typename is_pin_or_pin_group< list_builder>::type>::type, bool>::type
+    is_set( const list_builder &pins)
+    {
+        return read( pins) != 0;
+    }
+
 }
 
 
@@ -0,0 +1,223 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_PORT_TRANSACTION_HPP_
+#define AVR_UTILITIES_PORT_TRANSACTION_HPP_
+#include "avr_utilities/pin_definitions.hpp"
+
+namespace pin_definitions
+{
+    namespace detail
+    {
+        inline void store( register_reference reg, uint8_t value)
+        {
+            reg = value;
+        }
+
+        inline void store( const null_port &, uint8_t)
+        {
+            // do nothing;
+        }
+
+        /// meta function that removes all pins from 'pins' that are on any of the
+        /// ports of the pins in 'ports'.
+        template< typename pins, typename ports>
+        struct remove_ports
+        {
+            typedef typename remove_ports<
+                    typename remove_port< ports::head::port, pins>::type,
+                    typename ports::tail>::type type;
+        };
+
+        template< typename pins>
+        struct remove_ports< pins, empty_list>
+        {
+            typedef pins type;
+        };
+
+        template< typename list>
+        struct is_empty_list : false_type {};
+
+        template<>
+        struct is_empty_list< empty_list> : true_type {};
+
+        /// meta function that concatenates the lists of any number of pins, pin groups
+        /// or lists.
+        template< typename... builders>
+        struct concatenate_all;
+
+        template< typename head, typename... tail>
+        struct concatenate_all< head, tail...>
+        {
+            typedef typename concatenate_cons< head, typename concatenate_all< tail...>::type>::type type;
+        };
+
+        template<>
+        struct concatenate_all<>
+        {
+            typedef empty_list type;
+        };
+
+        /// Shadow copies of the output registers of all ports in a list of pins,
+        /// one byte per port.
+        /// Every operation is performed on all shadow copies, with the mask for
+        /// each port calculated at compile time. Ports that are not affected by an operation
+        /// have a zero mask and generate no code.
+        template< typename list>
+        struct port_shadow
+        {
+            static const PortPlaceholder port = list::head::port;
+            typedef port_shadow< typename remove_port< port, typename list::tail>::type> rest_type;
+
+            void load()
+            {
+                value = sample( get_port< port>( tag_port()));
+                rest.load();
+            }
+
+            void store() const
+            {
+                detail::store( get_port< port>( tag_port()), value);
+                rest.store();
+            }
+
+            template< typename pins>
+            void set()
+            {
+                value |= mask_for_port< port, pins>::value;
+                rest.template set< pins>();
+            }
+
+            template< typename pins>
+            void reset()
+            {
+                value &= ~mask_for_port< port, pins>::value;
+                rest.template reset< pins>();
+            }
+
+            template< typename pins, typename value_type>
+            void write( value_type new_value)
+            {
+                if (mask_for_port< port, pins>::value)
+                {
+                    value = (value & ~mask_for_port< port, pins>::value)
+                            | port_bits< port, pins>::scatter( new_value);
+                }
+                rest.template write< pins>( new_value);
+            }
+
+            uint8_t   value;
+            rest_type rest;
+        };
+
+        template<>
+        struct port_shadow< empty_list>
+        {
+            void load() {}
+            void store() const {}
+            template< typename pins> void set() {}
+            template< typename pins> void reset() {}
+            template< typename pins, typename value_type> void write( value_type) {}
+        };
+    }
+
+    /// A port_transaction collects changes to output pins and writes them to the port
+    /// registers in one go.
+    /// The template arguments are the pins, pin groups or lists of pins that may be
+    /// changed in the transaction. On construction, the output register of each of their
+    /// ports is read once into a shadow copy that the compiler can keep in a CPU register.
+    /// set(), reset() and write() only change the shadow copies and commit() stores every
+    /// shadow copy to its port with a single write, without reading the port again:
+    /// @code
+    ///     port_transaction< clk_type, data_type> transaction;
+    ///     transaction.reset( clk);
+    ///     transaction.write( data, value);
+    ///     transaction.commit(); // one store per port
+    ///     transaction.set( clk);
+    ///     transaction.commit();
+    /// @endcode
+    /// A commit also writes back the other pins of those ports, as they were when the
+    /// transaction was constructed (or last refreshed). Pins on the same ports that are changed
+    /// by interrupt handlers during the transaction will be overwritten.
+    template< typename... pins>
+    class port_transaction
+    {
+    public:
+        typedef typename detail::concatenate_all< pins...>::type list;
+
+        port_transaction()
+        {
+            refresh();
+        }
+
+        /// re-read the output registers of all ports into the shadow copies.
+        void refresh()
+        {
+            shadow.load();
+        }
+
+        /// write all shadow copies to their ports, exactly once per port.
+        void commit() const
+        {
+            shadow.store();
+        }
+
+        template< typename list_builder>
+        void set( const list_builder &)
+        {
+            typedef typename checked< list_builder>::type changed;
+            shadow.template set< changed>();
+        }
+
+        template< typename list_builder>
+        void reset( const list_builder &)
+        {
+            typedef typename checked< list_builder>::type changed;
+            shadow.template reset< changed>();
+        }
+
+        template< typename list_builder>
+        void clear( const list_builder &pins_to_clear)
+        {
+            reset( pins_to_clear);
+        }
+
+        /// write a value to a pin group or list of pins, using the same bit order as
+        /// the write() function for lists.
+        template< typename list_builder, typename value_type>
+        void write( const list_builder &, value_type value)
+        {
+            typedef typename checked< list_builder>::type changed;
+            shadow.template write< changed>( value);
+        }
+
+        /// write a value to a single pin. As with the write() function for single pins,
+        /// any non-zero value sets the pin.
+        template< PortPlaceholder port_, uint8_t bit_, typename value_type>
+        void write( const pin_definition< port_, bit_> &pin, value_type value)
+        {
+            if (value) set( pin);
+            else reset( pin);
+        }
+
+    private:
+        /// returns the list of the given pins, after checking that they are all
+        /// on ports that are part of this transaction.
+        template< typename list_builder>
+        struct checked
+        {
+            typedef typename list_builder::as_cons type;
+            static_assert(
+                    detail::is_empty_list< typename detail::remove_ports< type, list>::type>::value,
+                    "pins must be on ports that are part of the transaction");
+        };
+
+        detail::port_shadow< list> shadow;
+    };
+}
+
+#endif /* AVR_UTILITIES_PORT_TRANSACTION_HPP_ */
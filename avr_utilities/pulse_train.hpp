@@ -0,0 +1,228 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_PULSE_TRAIN_HPP_
+#define AVR_UTILITIES_PULSE_TRAIN_HPP_
+#include "avr_utilities/pin_definitions.hpp"
+
+/**
+ * Cycle exact pulse trains.
+ *
+ * A pulse train is a compile time sequence of steps. Every step sets some pins, resets
+ * some other pins and then waits a fixed number of cycles before the next step:
+ * \code
+ * PIN_TYPE( B, 1) data;
+ *
+ * // a WS2812 '1' bit at 16Mhz: 0.8us high, 0.45us low.
+ * typedef pulse_train<
+ *          set_step< PIN_TYPE( B, 1), 13>,
+ *          reset_step< PIN_TYPE( B, 1), 7>
+ *      > one_bit;
+ * ...
+ * make_output( data);
+ * one_bit::play();
+ * \endcode
+ *
+ * The cycle count of a step is the number of cycles between its port write and the
+ * port write of the next step (or the return from play() for the last step), so each count
+ * must at least cover the port write itself: one cycle for ports that are reachable with OUT
+ * and two cycles for the memory mapped ports.
+ *
+ * play() reads the port once and calculates the port value of every step before the
+ * first write. Each step then compiles to a single OUT or STS followed by an exact delay
+ * loop, with interrupts disabled for the duration of the train. All pins of a train must be on
+ * the same port and must already be configured as outputs. Other pins on that port keep the
+ * value they had when play() started.
+ *
+ * The port values of all steps are kept in CPU registers. For trains of more than 10 or
+ * so steps, check the listing to see that the compiler did not have to spill them.
+ */
+namespace pin_definitions
+{
+    /// a step in a pulse train: set the pins in 'high', reset the pins in 'low' and wait
+    /// 'cycles' cycles. 'high' and 'low' can be pins, pin groups, lists of pins or empty_list.
+    template< typename high, typename low, uint16_t cycles_>
+    struct step
+    {
+        typedef high high_pins;
+        typedef low  low_pins;
+        static const uint16_t cycles = cycles_;
+    };
+
+    template< typename pins, uint16_t cycles>
+    struct set_step : step< pins, empty_list, cycles> {};
+
+    template< typename pins, uint16_t cycles>
+    struct reset_step : step< empty_list, pins, cycles> {};
+
+    namespace detail
+    {
+        template< typename list_builder>
+        struct to_cons
+        {
+            typedef typename list_builder::as_cons type;
+        };
+
+        template<>
+        struct to_cons< empty_list>
+        {
+            typedef empty_list type;
+        };
+
+        /// meta function that returns all pins of a list of steps.
+        template< typename... steps>
+        struct step_pins;
+
+        template< typename head, typename... tail>
+        struct step_pins< head, tail...>
+        {
+            typedef typename concatenate_cons<
+                        typename to_cons< typename head::high_pins>::type,
+                        typename concatenate_cons<
+                            typename to_cons< typename head::low_pins>::type,
+                            typename step_pins< tail...>::type
+                        >::type
+                    >::type type;
+        };
+
+        template<>
+        struct step_pins<>
+        {
+            typedef empty_list type;
+        };
+
+        /// meta function that returns true iff all pins in 'list' are on 'port'.
+        template< PortPlaceholder port, typename list>
+        struct all_on_port
+        {
+            static const bool value =
+                    is_same_port< port, list::head::port>::value
+                and all_on_port< port, typename list::tail>::value;
+        };
+
+        template< PortPlaceholder port>
+        struct all_on_port< port, empty_list>
+        {
+            static const bool value = true;
+        };
+
+        /// force a value into a CPU register at this point in the instruction stream.
+        inline PIN_DEF_ALWAYS_INLINE void materialize( uint8_t &value)
+        {
+            asm volatile( "" : "+r" (value));
+        }
+
+        /// write a value to the output register of a port and return after exactly
+        /// 'cycles' cycles.
+        template< PortPlaceholder port, uint16_t cycles>
+        inline PIN_DEF_ALWAYS_INLINE void timed_write( uint8_t value)
+        {
+            typedef port_traits< port> traits;
+            static const uint8_t write_cycles = traits::io_addressable? 1 : 2;
+            static_assert( cycles >= write_cycles, "a step must take at least as long as its port write");
+
+#if defined(AVR_UTILITIES_SIMULATION)
+            // a simulated register access counts as one cycle.
+            get_port< port>( tag_port()) = value;
+            simulation::register_file::instance().delay_cycles( cycles - 1);
+#else
+            if (traits::io_addressable)
+            {
+                asm volatile( "out %0, %1" :: "I" (traits::port_address - __SFR_OFFSET), "r" (value));
+            }
+            else
+            {
+                asm volatile( "sts %0, %1" :: "n" (traits::port_address), "r" (value));
+            }
+            __builtin_avr_delay_cycles( cycles - write_cycles);
+#endif
+        }
+
+        /// writes precalculated port values, one per step.
+        template< PortPlaceholder port, typename... steps>
+        struct step_writer;
+
+        template< PortPlaceholder port, typename head, typename... tail>
+        struct step_writer< port, head, tail...>
+        {
+            template< typename... values>
+            static inline PIN_DEF_ALWAYS_INLINE void write( uint8_t value, values... rest)
+            {
+                timed_write< port, head::cycles>( value);
+                step_writer< port, tail...>::write( rest...);
+            }
+        };
+
+        template< PortPlaceholder port>
+        struct step_writer< port>
+        {
+            static inline PIN_DEF_ALWAYS_INLINE void write()
+            {
+            }
+        };
+
+        /// calculates the port values of all steps and then hands them to a step_writer.
+        /// After the steps so far, the port value is (start & keep) | ones.
+        template< PortPlaceholder port, typename writer, uint8_t keep, uint8_t ones, typename... steps>
+        struct step_values;
+
+        template< PortPlaceholder port, typename writer, uint8_t keep, uint8_t ones, typename head, typename... tail>
+        struct step_values< port, writer, keep, ones, head, tail...>
+        {
+            static const uint8_t high = mask_for_port< port, typename to_cons< typename head::high_pins>::type>::value;
+            static const uint8_t low  = mask_for_port< port, typename to_cons< typename head::low_pins>::type>::value;
+
+            template< typename... values>
+            static inline PIN_DEF_ALWAYS_INLINE void calculate( uint8_t start, values... previous)
+            {
+                uint8_t value = (start & (keep & ~(high | low))) | ((ones & ~low) | high);
+                materialize( value);
+                step_values<
+                    port, writer,
+                    keep & ~(high | low), (ones & ~low) | high,
+                    tail...>::calculate( start, previous..., value);
+            }
+        };
+
+        template< PortPlaceholder port, typename writer, uint8_t keep, uint8_t ones>
+        struct step_values< port, writer, keep, ones>
+        {
+            template< typename... values>
+            static inline PIN_DEF_ALWAYS_INLINE void calculate( uint8_t, values... all)
+            {
+                writer::write( all...);
+            }
+        };
+    }
+
+    /// A sequence of steps that is played with exact timing. See the description at the top
+    /// of this file.
+    template< typename... steps>
+    struct pulse_train
+    {
+        static_assert( sizeof...( steps) > 0, "a pulse train needs at least one step");
+
+        typedef typename detail::step_pins< steps...>::type pins;
+        static const PortPlaceholder port = pins::head::port;
+        static_assert(
+                detail::all_on_port< port, pins>::value,
+                "all pins of a pulse train must be on the same port");
+
+        static void play()
+        {
+            const uint8_t status = SREG;
+            cli();
+            detail::step_values<
+                port, detail::step_writer< port, steps...>,
+                0xff, 0x00,
+                steps...>::calculate( detail::sample( get_port< port>( tag_port())));
+            SREG = status;
+        }
+    };
+}
+
+#endif /* AVR_UTILITIES_PULSE_TRAIN_HPP_ */
@@ -0,0 +1,200 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_RECORD_BUFFER_HPP_
+#define AVR_UTILITIES_RECORD_BUFFER_HPP_
+#include "avr_utilities/round_robin_buffer.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * A FIFO of variable length records, built on round_robin_buffer.
+ *
+ * Each record is stored as a length prefix followed by its bytes. The producer builds a
+ * record with begin_record(), any number of append() calls and commit_record(). The record
+ * only becomes visible to the consumer when it is committed, so a half-built record
+ * can still be dropped with abort_record():
+ * \code
+ * record_buffer< 128> packets;
+ *
+ * // producer
+ * packets.begin_record();
+ * packets.append( header, sizeof header);
+ * packets.append( checksum);
+ * packets.commit_record();
+ *
+ * // consumer
+ * record_buffer< 128>::record r;
+ * if (packets.peek_record( r))
+ * {
+ *     parse( r); // using r.length and r[index]
+ *     packets.pop_record();
+ * }
+ * \endcode
+ *
+ * The consumer accesses the record in place. Because a record may wrap around the end of
+ * the buffer, it is presented as at most two contiguous parts.
+ */
+template< uint16_t buffer_size = 64, typename length_type = uint8_t>
+class record_buffer
+{
+public:
+    typedef round_robin_buffer< buffer_size, uint8_t> buffer_type;
+
+    /// a view on a committed record in the buffer.
+    struct record
+    {
+        length_type    length;       ///< total number of bytes in the record
+        const uint8_t *first;        ///< first contiguous part of the record
+        length_type    first_length; ///< number of bytes in the first part
+        const uint8_t *second;       ///< rest of the record, at the start of the buffer
+
+        uint8_t operator[]( length_type index) const
+        {
+            return index < first_length ? first[index] : second[index - first_length];
+        }
+
+        /// copy the complete record to 'destination', which must have room for 'length' bytes.
+        void copy_to( uint8_t *destination) const
+        {
+            memcpy( destination, first, first_length);
+            memcpy( destination + first_length, second, length - first_length);
+        }
+    };
+
+    record_buffer()
+    : in_record( false), record_length( 0)
+    {
+    }
+
+    // producer side
+
+    /// start a new record. Any uncommitted record is discarded.
+    /// Returns false if there is no room for the length prefix.
+    bool begin_record() volatile
+    {
+        abort_record();
+        if (buffer.available() < sizeof( length_type)) return false;
+
+        // reserve the length prefix byte by byte, because it may wrap around the end of
+        // the buffer. It is filled in by commit_record().
+        for (uint8_t index = 0; index < sizeof( length_type); ++index)
+        {
+            uint8_t *slot;
+            buffer.writable_span( slot);
+            length_slots[index] = slot;
+            buffer.advance_tentative( 1);
+        }
+        record_length = 0;
+        in_record = true;
+        return true;
+    }
+
+    /// add a byte to the current record.
+    bool append( uint8_t value) volatile
+    {
+        return append( &value, 1);
+    }
+
+    /// add a number of bytes to the current record. Either all bytes are added or, if
+    /// there is no room for them, none.
+    bool append( const uint8_t *values, length_type count) volatile
+    {
+        if (not in_record or count > length_type( ~record_length)) return false;
+
+        // check the size before write_span() narrows count to the index type of the buffer.
+        if (count > buffer.available()) return false;
+        if (not buffer.write_span( values, count)) return false;
+        record_length += count;
+        return true;
+    }
+
+    /// fill in the length prefix and make the record available to the consumer.
+    bool commit_record() volatile
+    {
+        if (not in_record) return false;
+
+        length_type length = record_length;
+        for (uint8_t index = 0; index < sizeof( length_type); ++index)
+        {
+            *length_slots[index] = static_cast<uint8_t>( length);
+            length >>= 8;
+        }
+        buffer.commit();
+        in_record = false;
+        return true;
+    }
+
+    /// discard the current, uncommitted record.
+    void abort_record() volatile
+    {
+        buffer.reset_tentative();
+        in_record = false;
+    }
+
+    // consumer side
+
+    /// return true if a committed record is available and let 'result' refer to it.
+    /// The record stays in the buffer until pop_record() is called.
+    bool peek_record( record &result) const volatile
+    {
+        // only look at committed data: the producer may have filled the rest of the buffer
+        // with a record that is still being built.
+        const uint16_t committed = buffer.committed();
+        if (committed < sizeof( length_type)) return false;
+
+        length_type length = 0;
+        for (uint8_t index = sizeof( length_type); index--; )
+        {
+            length = static_cast<length_type>( length << 8) | *buffer.at( index);
+        }
+        if (committed - sizeof( length_type) < length) return false;
+
+        // the committed data from the read index up to the end of the buffer (or up
+        // to the write index) is contiguous. If the record is longer than that, it continues at
+        // the start of the buffer.
+        const uint8_t *region;
+        const uint16_t contiguous = buffer.peek_span( region);
+        result.length = length;
+        result.first = buffer.at( sizeof( length_type));
+        if (contiguous >= sizeof( length_type) + length or contiguous <= sizeof( length_type))
+        {
+            result.first_length = length;
+            result.second = result.first + length;
+        }
+        else
+        {
+            result.first_length = contiguous - sizeof( length_type);
+            result.second = buffer.at( contiguous);
+        }
+        return true;
+    }
+
+    /// remove the oldest record from the buffer.
+    void pop_record() volatile
+    {
+        record r;
+        if (peek_record( r))
+        {
+            buffer.consume( sizeof( length_type) + r.length);
+        }
+    }
+
+    bool empty() const volatile
+    {
+        return buffer.empty();
+    }
+
+private:
+    buffer_type    buffer;
+    bool           in_record;
+    length_type    record_length;
+    uint8_t       *length_slots[sizeof( length_type)];
+};
+
+#endif /* AVR_UTILITIES_RECORD_BUFFER_HPP_ */
@@ -2,24 +2,214 @@
 #define ROUND_ROBIN_BUFFER_H
 
 #include <stdint.h>
+#include <string.h>
 
-template<uint8_t buffer_size = 64, typename datatype = uint8_t>
+#if defined(__AVR__)
+#   include <avr/io.h>
+#   include <avr/interrupt.h>
+#endif
+
+namespace round_robin_detail
+{
+    /// the smallest unsigned type that can hold all indices and the size of a buffer.
+    template< uint16_t buffer_size, bool fits_in_byte = (buffer_size < 256)>
+    struct index_type
+    {
+        typedef uint8_t type;
+    };
+
+    template< uint16_t buffer_size>
+    struct index_type< buffer_size, false>
+    {
+        typedef uint16_t type;
+    };
+
+    /// Advance an index, wrapping around at the end of the buffer.
+    /// For power-of-two sizes this is a single AND, for other sizes a compare. Both avoid
+    /// the modulo operator, which for non-power-of-two sizes compiles into a call to a
+    /// division routine on avr.
+    template< uint16_t buffer_size, bool power_of_two = ((buffer_size & (buffer_size - 1)) == 0)>
+    struct wrap
+    {
+        template< typename index>
+        static index next( index i)
+        {
+            return (i + 1) & (buffer_size - 1);
+        }
+
+        template< typename index>
+        static index advance( index i, index count)
+        {
+            return (i + count) & (buffer_size - 1);
+        }
+    };
+
+    template< uint16_t buffer_size>
+    struct wrap< buffer_size, false>
+    {
+        template< typename index>
+        static index next( index i)
+        {
+            return (i + 1 == buffer_size) ? 0 : i + 1;
+        }
+
+        template< typename index>
+        static index advance( index i, index count)
+        {
+            // count <= buffer_size, so one subtraction suffices.
+            const uint16_t sum = i + count;
+            return (sum >= buffer_size) ? sum - buffer_size : sum;
+        }
+    };
+
+    /// Read an index that may be changed by an interrupt handler.
+    /// Single byte indices are read as-is. 16-bit indices are read until two consecutive
+    /// reads agree, so that a half-updated value is never used. This only protects readers
+    /// that can be interrupted by the writer. Writes that an interrupt handler reads are
+    /// made in a critical_section.
+    inline uint8_t load( const volatile uint8_t &index)
+    {
+        return index;
+    }
+
+    inline uint16_t load( const volatile uint16_t &index)
+    {
+        uint16_t value;
+        do
+        {
+            value = index;
+        } while (value != index);
+        return value;
+    }
+
+    /// Disables interrupts for the lifetime of the object, so that an index and the flags
+    /// that go with it change at once for an interrupt handler on the other side. This also
+    /// makes sure that an interrupt handler never sees a half-written 16-bit index.
+    /// On the host this does nothing.
+    class critical_section
+    {
+    public:
+#if defined(__AVR__)
+        critical_section()
+        : status( SREG)
+        {
+            cli();
+        }
+
+        ~critical_section()
+        {
+            SREG = status;
+        }
+
+    private:
+        const uint8_t status;
+#else
+        critical_section()
+        {
+        }
+#endif
+    };
+}
+
+/// Policies for writing to a full round_robin_buffer.
+namespace round_robin_policy
+{
+    /// writes to a full buffer fail. This is the default.
+    struct reject_when_full
+    {
+        static const bool overwrite = false;
+
+        template< typename index_type>
+        struct statistics
+        {
+            void count_overwritten( index_type) volatile {}
+            void record_level( index_type) volatile {}
+        };
+    };
+
+    /// writes to a full buffer remove the oldest committed values to make room, so
+    /// that the newest data is never lost. The buffer counts the number of overwritten
+    /// values and keeps track of the highest fill level.
+    /// Because the producer then also moves the read index, the consumer must read
+    /// with the producer blocked, e.g. with interrupts disabled if the producer is an
+    /// interrupt handler.
+    struct overwrite_oldest
+    {
+        static const bool overwrite = true;
+
+        template< typename index_type>
+        struct statistics
+        {
+            statistics()
+            : overwritten_count( 0), high_water( 0)
+            {
+            }
+
+            /// the number of values that were overwritten before they were read.
+            /// The producer may update the counter in an interrupt handler, so it is read
+            /// with interrupts disabled.
+            uint16_t overwritten() const volatile
+            {
+                round_robin_detail::critical_section guard;
+                return overwritten_count;
+            }
+
+            /// the highest number of values that were in the buffer at any time.
+            index_type high_water_mark() const volatile
+            {
+                round_robin_detail::critical_section guard;
+                return high_water;
+            }
+
+            void reset_statistics() volatile
+            {
+                round_robin_detail::critical_section guard;
+                overwritten_count = 0;
+                high_water = 0;
+            }
+
+            void count_overwritten( index_type count) volatile
+            {
+                // saturate instead of wrapping around.
+                overwritten_count = (overwritten_count > 0xffff - count) ? 0xffff : overwritten_count + count;
+            }
+
+            void record_level( index_type level) volatile
+            {
+                if (level > high_water) high_water = level;
+            }
+
+        private:
+            uint16_t   overwritten_count;
+            index_type high_water;
+        };
+    };
+}
+
+/// A fixed size FIFO that can be shared between an interrupt handler and the main program.
+/// Buffers of up to 255 elements use 8-bit indices, larger buffers (on devices with enough RAM)
+/// use 16-bit indices. Power-of-two sizes are the fastest, because indices then wrap with a mask.
+/// The policy determines what happens when writing to a full buffer, see round_robin_policy.
+template<uint16_t buffer_size = 64, typename datatype = uint8_t, typename policy = round_robin_policy::reject_when_full>
 struct round_robin_buffer
+    : public policy::template statistics< typename round_robin_detail::index_type< buffer_size>::type>
 {
 public:
 
     typedef datatype value_type;
+    typedef typename round_robin_detail::index_type< buffer_size>::type index_type;
 
 
     /// tentative writes, write to the buffer, but don't
     /// make the data available to readers yet.
     bool __attribute__((noinline)) write_tentative( value_type value) volatile
     {
-        if (!is_full)
+        if (!is_full || make_room( 1))
         {
             buffer[tentative_index] = value;
-            tentative_index = (tentative_index + 1) % buffer_size;
-            is_full = tentative_index == read_index;
+            tentative_index = next( tentative_index);
+            is_full = tentative_index == round_robin_detail::load( read_index);
+            update_high_water();
             return true;
         }
         else
@@ -31,19 +221,71 @@ public:
     /// remove all tentative writes
     void reset_tentative() volatile
     {
-        if (tentative_index != write_index)
-        {
-            is_full = false;
-        }
+        round_robin_detail::critical_section guard;
         tentative_index = write_index;
+        is_full = committed_full;
     }
 
 
     /// commit all tentative writes, making them
-    /// available to readers.
-    void commit() volatile
+    /// available to readers. Returns the number of values that were committed.
+    index_type commit() volatile
     {
+        round_robin_detail::critical_section guard;
+        const index_type added = uncommitted();
         write_index = tentative_index;
+        committed_full = is_full;
+        return added;
+    }
+
+    /// tentatively write 'count' values. Either all values are written or, if there is not
+    /// enough room in the buffer, none of them.
+    bool write_span( const value_type *values, index_type count) volatile
+    {
+        if (count > available() && !make_room( count)) return false;
+
+        value_type *region;
+        index_type first = writable_span( region);
+        if (first > count) first = count;
+        memcpy( region, values, first * sizeof( value_type));
+        memcpy( const_cast< value_type *>( buffer), values + first, (count - first) * sizeof( value_type));
+        advance_tentative( count);
+        return true;
+    }
+
+    /// return the largest contiguous region that can be written tentatively, without
+    /// wrapping around the end of the buffer.
+    /// After writing into the region, call advance_tentative() with the number of
+    /// values written.
+    index_type writable_span( value_type *&region) volatile
+    {
+        region = const_cast< value_type *>( buffer) + tentative_index;
+        if (is_full) return 0;
+
+        const index_type read = round_robin_detail::load( read_index);
+        return (tentative_index < read) ? read - tentative_index : buffer_size - tentative_index;
+    }
+
+    /// add 'count' values that were written directly into the region returned by
+    /// writable_span() to the tentative writes.
+    void advance_tentative( index_type count) volatile
+    {
+        if (count)
+        {
+            tentative_index = round_robin_detail::wrap< buffer_size>::advance( tentative_index, count);
+            is_full = tentative_index == round_robin_detail::load( read_index);
+            update_high_water();
+        }
+    }
+
+    /// return the number of values that can still be written tentatively.
+    index_type available() const volatile
+    {
+        if (is_full) return 0;
+
+        const index_type read = round_robin_detail::load( read_index);
+        return (tentative_index < read) ?
+                read - tentative_index : buffer_size - tentative_index + read;
     }
 
 /*
@@ -55,7 +297,7 @@ public:
         if (!is_full)
         {
             buffer[write_index] = value;
-            write_index = (write_index + 1) % buffer_size;
+            write_index = next( write_index);
             if (write_index == read_index)
             {
                 is_full = true;
@@ -73,9 +315,11 @@ public:
     {
         if (get_first( value))
         {
-            read_index = (read_index + 1) % buffer_size;
+            round_robin_detail::critical_section guard;
+            read_index = next( read_index);
  			is_full = false;
- 
+            committed_full = false;
+
             return true;
         }
         else
@@ -84,9 +328,61 @@ public:
         }
     }
 
+    /// read up to 'count' values from the queue and return the number of values read.
+    index_type read_span( value_type *values, index_type count) volatile
+    {
+        index_type total = 0;
+
+        // the committed data may wrap around the end of the buffer, so this takes at
+        // most two copies.
+        for (uint8_t part = 0; part < 2 && total < count; ++part)
+        {
+            const value_type *region;
+            index_type length = peek_span( region);
+            if (length > count - total) length = count - total;
+            memcpy( values + total, region, length * sizeof( value_type));
+            consume( length);
+            total += length;
+        }
+        return total;
+    }
+
+    /// return the largest contiguous region of committed values that can be read
+    /// without wrapping around the end of the buffer.
+    /// The region stays valid until consume() is called.
+    index_type peek_span( const value_type *&region) const volatile
+    {
+        region = const_cast< const value_type *>( buffer) + read_index;
+
+        const index_type write = round_robin_detail::load( write_index);
+        if (read_index == write && !committed_full) return 0;
+        return (read_index < write) ? write - read_index : buffer_size - read_index;
+    }
+
+    /// return a pointer to the committed value 'offset' positions after the oldest value.
+    /// The caller must make sure that offset < size().
+    const value_type *at( index_type offset) const volatile
+    {
+        return const_cast< const value_type *>( buffer)
+                + round_robin_detail::wrap< buffer_size>::advance( read_index, offset);
+    }
+
+    /// remove 'count' values from the queue, typically after they were processed through
+    /// the region returned by peek_span().
+    void consume( index_type count) volatile
+    {
+        if (count)
+        {
+            round_robin_detail::critical_section guard;
+            read_index = round_robin_detail::wrap< buffer_size>::advance( read_index, count);
+            is_full = false;
+            committed_full = false;
+        }
+    }
+
     bool get_first( value_type *value) const volatile
     {
-        if (read_index == write_index && !is_full)
+        if (read_index == round_robin_detail::load( write_index) && !committed_full)
         {
             return false;
         }
@@ -112,37 +408,89 @@ public:
     	while (!write_tentative( value)) /*nop*/;
 	}
 
+    /// return the number of committed values in the buffer. Values that were written
+    /// tentatively, but not committed yet, are not counted.
+    index_type committed() const volatile
+    {
+        const index_type write = round_robin_detail::load( write_index);
+        const index_type read = round_robin_detail::load( read_index);
+        if (write == read) return committed_full ? buffer_size : 0;
+        return distance( read, write);
+    }
+
+    /// return the number of values that were written tentatively but are not committed yet.
+    /// Only the writer should call this.
+    index_type uncommitted() const volatile
+    {
+        if (tentative_index == write_index) return (is_full && !committed_full) ? buffer_size : 0;
+        return distance( write_index, tentative_index);
+    }
+
     /// return the number of (committed) bytes in the buffer
-    uint8_t size() const volatile
+    index_type size() const volatile
 	{
-		if (is_full) return buffer_size;
-
-		const int8_t size = (int8_t) write_index - (int8_t)read_index;
-		if (size < 0)
-		{
-			return buffer_size + size;
-		}
-		else
-		{
-			return size;
-		}
+		return committed();
 	}
 
     /// return whether the buffer is empty
     bool empty() const volatile
 	{
-    	return write_index == read_index && !is_full;
+    	return round_robin_detail::load( write_index) == round_robin_detail::load( read_index) && !committed_full;
 	}
 
+    /// return whether there is no room for more (tentative) writes.
     bool full() const volatile
 	{
     	return is_full;
 	}
 private:
-    bool    is_full;
-    uint8_t tentative_index;
-    uint8_t write_index;
-    uint8_t read_index;
+    static index_type next( index_type index)
+    {
+        return round_robin_detail::wrap< buffer_size>::next( index);
+    }
+
+    /// the number of values from index 'from' up to index 'to', where equal indices
+    /// count as zero.
+    static index_type distance( index_type from, index_type to)
+    {
+        return (from <= to) ? to - from : buffer_size - from + to;
+    }
+
+    /// with the overwrite_oldest policy, drop the oldest committed values so that 'count'
+    /// values can be written. Uncommitted values are never dropped.
+    bool make_room( index_type count) volatile
+    {
+        if (!policy::overwrite || count > buffer_size) return false;
+
+        const index_type free = available();
+        if (count <= free) return true;
+
+        const index_type drop = count - free;
+        if (drop > committed()) return false;
+
+        {
+            round_robin_detail::critical_section guard;
+            read_index = round_robin_detail::wrap< buffer_size>::advance( read_index, drop);
+            is_full = false;
+            committed_full = false;
+        }
+        this->count_overwritten( drop);
+        return true;
+    }
+
+    void update_high_water() volatile
+    {
+        if (policy::overwrite)
+        {
+            this->record_level( buffer_size - available());
+        }
+    }
+
+    bool       is_full;        ///< tentative_index caught up with read_index
+    bool       committed_full; ///< write_index caught up with read_index
+    index_type tentative_index;
+    index_type write_index;
+    index_type read_index;
     value_type buffer[buffer_size];
 
 };
@@ -0,0 +1,321 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_SIMULATION_REGISTERS_HPP_
+#define AVR_UTILITIES_SIMULATION_REGISTERS_HPP_
+
+/**
+ * Simulated register file for running pin_definitions based code on a host.
+ *
+ * When AVR_UTILITIES_SIMULATION is defined, pin_definitions.hpp includes this file
+ * instead of <avr/io.h>. All port registers then refer to a simulated register file,
+ * which records every read and write with a sequence number and an (approximate)
+ * cycle count. The simulated mcu has the port layout of an ATmega2560, so ports A-L
+ * are available.
+ *
+ * The register file behaves like the real I/O ports where it matters for drivers:
+ * reading PINx returns the PORTx value for output pins and the externally driven level
+ * (see register_file::drive()) for input pins, and writing ones to PINx toggles
+ * the corresponding PORTx bits.
+ *
+ * Every register access counts as one cycle and _delay_us()/_delay_ms() advance the
+ * cycle counter according to F_CPU, so the cycle stamps give an estimate of the timing
+ * of a driver, not an exact count.
+ *
+ * PROGMEM, pgm_read_byte() and pgm_read_word() are provided as well, as plain memory
+ * accesses, so that code with tables in flash runs unchanged.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(F_CPU)
+#   define F_CPU 16000000UL
+#endif
+
+namespace simulation
+{
+    /// One read or write of a simulated register.
+    struct access
+    {
+        uint32_t sequence;  ///< number of the access, starting at zero.
+        uint64_t cycle;     ///< estimated cpu cycle at which the access took place.
+        uint16_t address;   ///< memory address of the register.
+        uint8_t  value;     ///< value read or written.
+        bool     is_write;
+    };
+
+    /// Interface for objects that want to be notified of every register access.
+    class observer
+    {
+    public:
+        virtual void on_access( const access &a) = 0;
+        virtual ~observer() {}
+    };
+
+    /// The memory addresses of the PINx register of each simulated port.
+    /// DDRx and PORTx follow directly after PINx.
+    static const uint16_t port_base_addresses[] = {
+            0x20, 0x23, 0x26, 0x29, 0x2C, 0x2F, 0x32,   // A-G
+            0x100, 0x103, 0x106, 0x109                  // H, J, K, L
+    };
+
+    class register_file
+    {
+    public:
+        static const uint16_t size = 0x200;
+
+        /// The one simulated register file.
+        static register_file &instance()
+        {
+            static register_file file;
+            return file;
+        }
+
+        register_file()
+        : m_observer( 0)
+        {
+            reset();
+        }
+
+        /// set all registers, inputs and counters to zero.
+        void reset()
+        {
+            memset( m_memory, 0, sizeof m_memory);
+            memset( m_external, 0, sizeof m_external);
+            m_sequence = 0;
+            m_cycle = 0;
+        }
+
+        /// register an observer that will be notified of every register access.
+        /// Pass a null pointer to stop tracing.
+        void set_observer( observer *o)
+        {
+            m_observer = o;
+        }
+
+        uint8_t read( uint16_t address)
+        {
+            const uint8_t value = is_pin_register( address)?
+                      (m_memory[address + 2] & m_memory[address + 1])
+                    | (m_external[address] & ~m_memory[address + 1])
+                    : m_memory[address];
+            record( address, value, false);
+            return value;
+        }
+
+        void write( uint16_t address, uint8_t value)
+        {
+            if (is_pin_register( address))
+            {
+                // writing ones to PINx toggles the corresponding PORTx bits.
+                m_memory[address + 2] ^= value;
+            }
+            else
+            {
+                m_memory[address] = value;
+            }
+            record( address, value, true);
+        }
+
+        /// read a register without recording the access.
+        uint8_t peek( uint16_t address) const
+        {
+            return m_memory[address];
+        }
+
+        /// set the level that is applied externally to the pins in 'mask' of the port with
+        /// the given PINx address. This level is visible when reading PINx for pins that
+        /// are configured as input.
+        void drive( uint16_t pin_address, uint8_t mask, bool level)
+        {
+            if (level) m_external[pin_address] |= mask;
+            else m_external[pin_address] &= ~mask;
+        }
+
+        /// let simulated time pass.
+        void delay_cycles( uint64_t cycles)
+        {
+            m_cycle += cycles;
+        }
+
+        uint64_t cycle() const
+        {
+            return m_cycle;
+        }
+
+        uint32_t sequence() const
+        {
+            return m_sequence;
+        }
+
+        static bool is_pin_register( uint16_t address)
+        {
+            for (uint8_t index = 0; index < sizeof port_base_addresses/sizeof port_base_addresses[0]; ++index)
+            {
+                if (port_base_addresses[index] == address) return true;
+            }
+            return false;
+        }
+
+    private:
+        void record( uint16_t address, uint8_t value, bool is_write)
+        {
+            ++m_cycle;
+            if (m_observer)
+            {
+                const access a = { m_sequence, m_cycle, address, value, is_write};
+                m_observer->on_access( a);
+            }
+            ++m_sequence;
+        }
+
+        uint8_t   m_memory[size];
+        uint8_t   m_external[size];
+        uint32_t  m_sequence;
+        uint64_t  m_cycle;
+        observer *m_observer;
+    };
+
+    /// A reference to a simulated register.
+    /// This type takes the place of volatile uint8_t & in the simulation.
+    class register_ref
+    {
+    public:
+        explicit register_ref( uint16_t address)
+        : address( address)
+        {
+        }
+
+        register_ref( const register_ref &other)
+        : address( other.address)
+        {
+        }
+
+        operator uint8_t() const
+        {
+            return register_file::instance().read( address);
+        }
+
+        const register_ref &operator=( uint8_t value) const
+        {
+            register_file::instance().write( address, value);
+            return *this;
+        }
+
+        const register_ref &operator=( const register_ref &other) const
+        {
+            return *this = static_cast<uint8_t>( other);
+        }
+
+        const register_ref &operator|=( uint8_t value) const
+        {
+            return *this = static_cast<uint8_t>( *this | value);
+        }
+
+        const register_ref &operator&=( uint8_t value) const
+        {
+            return *this = static_cast<uint8_t>( *this & value);
+        }
+
+        const register_ref &operator^=( uint8_t value) const
+        {
+            return *this = static_cast<uint8_t>( *this ^ value);
+        }
+
+        const uint16_t address;
+    };
+
+    /// recorder that stores all register accesses in a fixed size buffer.
+    template< uint32_t capacity = 1024>
+    class recorder : public observer
+    {
+    public:
+        recorder()
+        : m_count( 0)
+        {
+        }
+
+        virtual void on_access( const access &a)
+        {
+            if (m_count < capacity) m_accesses[m_count++] = a;
+        }
+
+        uint32_t count() const { return m_count;}
+        const access &operator[]( uint32_t index) const { return m_accesses[index];}
+        void clear() { m_count = 0;}
+
+    private:
+        uint32_t m_count;
+        access   m_accesses[capacity];
+    };
+}
+
+// register definitions, modeled after avr-libc.
+#define __SFR_OFFSET 0x20
+#define _MMIO_BYTE( mem_addr) (simulation::register_ref( mem_addr))
+#define _SFR_MEM8( mem_addr) _MMIO_BYTE( mem_addr)
+#define _SFR_IO8( io_addr) _MMIO_BYTE( (io_addr) + __SFR_OFFSET)
+
+#if !defined( _BV)
+#   define _BV( bit) (1 << (bit))
+#endif
+
+#define PINA  _SFR_IO8( 0x00)
+#define DDRA  _SFR_IO8( 0x01)
+#define PORTA _SFR_IO8( 0x02)
+#define PINB  _SFR_IO8( 0x03)
+#define DDRB  _SFR_IO8( 0x04)
+#define PORTB _SFR_IO8( 0x05)
+#define PINC  _SFR_IO8( 0x06)
+#define DDRC  _SFR_IO8( 0x07)
+#define PORTC _SFR_IO8( 0x08)
+#define PIND  _SFR_IO8( 0x09)
+#define DDRD  _SFR_IO8( 0x0A)
+#define PORTD _SFR_IO8( 0x0B)
+#define PINE  _SFR_IO8( 0x0C)
+#define DDRE  _SFR_IO8( 0x0D)
+#define PORTE _SFR_IO8( 0x0E)
+#define PINF  _SFR_IO8( 0x0F)
+#define DDRF  _SFR_IO8( 0x10)
+#define PORTF _SFR_IO8( 0x11)
+#define PING  _SFR_IO8( 0x12)
+#define DDRG  _SFR_IO8( 0x13)
+#define PORTG _SFR_IO8( 0x14)
+#define PINH  _SFR_MEM8( 0x100)
+#define DDRH  _SFR_MEM8( 0x101)
+#define PORTH _SFR_MEM8( 0x102)
+#define PINJ  _SFR_MEM8( 0x103)
+#define DDRJ  _SFR_MEM8( 0x104)
+#define PORTJ _SFR_MEM8( 0x105)
+#define PINK  _SFR_MEM8( 0x106)
+#define DDRK  _SFR_MEM8( 0x107)
+#define PORTK _SFR_MEM8( 0x108)
+#define PINL  _SFR_MEM8( 0x109)
+#define DDRL  _SFR_MEM8( 0x10A)
+#define PORTL _SFR_MEM8( 0x10B)
+#define SREG  _SFR_IO8( 0x3F)
+
+#define cli() ((void)(SREG &= 0x7f))
+#define sei() ((void)(SREG |= 0x80))
+
+// flash memory is ordinary memory on the host.
+#define PROGMEM
+#define pgm_read_byte( address_) (*(const uint8_t *)(address_))
+#define pgm_read_word( address_) (*(const uint16_t *)(address_))
+
+inline void _delay_us( double us)
+{
+    simulation::register_file::instance().delay_cycles( static_cast<uint64_t>( us * (F_CPU / 1e6)));
+}
+
+inline void _delay_ms( double ms)
+{
+    simulation::register_file::instance().delay_cycles( static_cast<uint64_t>( ms * (F_CPU / 1e3)));
+}
+
+#endif /* AVR_UTILITIES_SIMULATION_REGISTERS_HPP_ */
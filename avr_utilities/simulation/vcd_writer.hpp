@@ -0,0 +1,214 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_SIMULATION_VCD_WRITER_HPP_
+#define AVR_UTILITIES_SIMULATION_VCD_WRITER_HPP_
+#include "avr_utilities/pin_definitions.hpp"
+
+#include <stdio.h>
+
+/**
+ * Value Change Dump output of simulated port traffic.
+ *
+ * A vcd_writer observes the simulated register file and writes a VCD file that
+ * can be viewed with e.g. GTKWave. Each signal is a pin or pin group:
+ * \code
+ * FILE *out = fopen( "spi.vcd", "w");
+ * simulation::vcd_writer vcd( out);
+ * VCD_SIGNAL( vcd, pins.clk);
+ * VCD_SIGNAL( vcd, pins.mosi);
+ * vcd.start();
+ * spi::transmit_receive( 0xa5);
+ * vcd.finish();
+ * \endcode
+ *
+ * The level of a signal is the PORTx bit for pins that are configured as output and 'z' for
+ * input pins. Time is expressed in picoseconds and is derived from the (estimated)
+ * cycle count of the register file and F_CPU.
+ * While it is started, the vcd_writer is the observer of the register file, replacing any
+ * other observer.
+ */
+namespace simulation
+{
+    class vcd_writer : public observer
+    {
+    public:
+        static const uint8_t max_signals = 32;
+        static const uint8_t max_name = 32;
+
+        explicit vcd_writer( FILE *out, const char *module = "avr")
+        : m_out( out), m_module( module), m_count( 0), m_last_cycle( 0), m_started( false)
+        {
+        }
+
+        ~vcd_writer()
+        {
+            finish();
+        }
+
+        /// add a pin or pin group as a signal with the given name. Characters in the
+        /// name that are not allowed in a VCD identifier are replaced by underscores.
+        /// All signals must be added before start() is called.
+        template< typename pin_type>
+        bool add_signal( const char *name, const pin_type &)
+        {
+            typedef pin_definitions::port_traits< pin_type::port> traits;
+            static_assert( traits::ddr_address == traits::pin_address + 1
+                    and traits::port_address == traits::pin_address + 2,
+                    "vcd_writer requires the DDRx and PORTx registers to directly follow PINx");
+            return add_signal( name,
+                    pin_definitions::port_traits< pin_type::port>::pin_address,
+                    pin_type::shift, pin_type::width);
+        }
+
+        bool add_signal( const char *name, uint16_t pin_address, uint8_t shift, uint8_t width)
+        {
+            if (m_started or m_count == max_signals) return false;
+
+            signal &s = m_signals[m_count];
+            uint8_t index = 0;
+            for (; name[index] and index < max_name - 1; ++index)
+            {
+                const char c = name[index];
+                const bool valid =
+                           (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z')
+                        or (c >= '0' and c <= '9') or c == '_';
+                s.name[index] = valid? c : '_';
+            }
+            s.name[index] = 0;
+            s.pin_address = pin_address;
+            s.shift = shift;
+            s.width = width;
+            s.value[0] = 0;
+            ++m_count;
+            return true;
+        }
+
+        /// write the VCD header and the initial values of all signals and start observing
+        /// the register file.
+        void start()
+        {
+            fprintf( m_out, "$timescale 1ps $end\n");
+            fprintf( m_out, "$scope module %s $end\n", m_module);
+            for (uint8_t index = 0; index < m_count; ++index)
+            {
+                fprintf( m_out, "$var wire %u %c %s $end\n",
+                        m_signals[index].width, identifier( index), m_signals[index].name);
+            }
+            fprintf( m_out, "$upscope $end\n$enddefinitions $end\n");
+
+            m_last_cycle = register_file::instance().cycle();
+            fprintf( m_out, "#%llu\n$dumpvars\n", timestamp( m_last_cycle));
+            for (uint8_t index = 0; index < m_count; ++index)
+            {
+                update( index);
+                emit( index);
+            }
+            fprintf( m_out, "$end\n");
+
+            register_file::instance().set_observer( this);
+            m_started = true;
+        }
+
+        /// stop observing the register file and write the final timestamp.
+        void finish()
+        {
+            if (not m_started) return;
+            register_file::instance().set_observer( 0);
+            fprintf( m_out, "#%llu\n", timestamp( register_file::instance().cycle()));
+            fflush( m_out);
+            m_started = false;
+        }
+
+        virtual void on_access( const access &a)
+        {
+            if (not a.is_write) return;
+
+            for (uint8_t index = 0; index < m_count; ++index)
+            {
+                const uint16_t base = m_signals[index].pin_address;
+                if (a.address < base or a.address > base + 2) continue;
+                if (update( index))
+                {
+                    if (a.cycle != m_last_cycle)
+                    {
+                        fprintf( m_out, "#%llu\n", timestamp( a.cycle));
+                        m_last_cycle = a.cycle;
+                    }
+                    emit( index);
+                }
+            }
+        }
+
+    private:
+        struct signal
+        {
+            char     name[max_name];
+            uint16_t pin_address;
+            uint8_t  shift;
+            uint8_t  width;
+            char     value[9];
+        };
+
+        static char identifier( uint8_t index)
+        {
+            return '!' + index;
+        }
+
+        static unsigned long long timestamp( uint64_t cycle)
+        {
+            return cycle * (1000000000000ULL / F_CPU);
+        }
+
+        /// recalculate the value of a signal from the DDRx and PORTx registers.
+        /// Returns true if the value changed.
+        bool update( uint8_t index)
+        {
+            signal &s = m_signals[index];
+            const register_file &file = register_file::instance();
+            const uint8_t ddr  = file.peek( s.pin_address + 1);
+            const uint8_t port = file.peek( s.pin_address + 2);
+
+            char value[9];
+            for (uint8_t bit = 0; bit < s.width; ++bit)
+            {
+                const uint8_t mask = 1 << (s.shift + s.width - 1 - bit);
+                value[bit] = (ddr & mask)? ((port & mask)? '1':'0') : 'z';
+            }
+            value[s.width] = 0;
+
+            if (strcmp( value, s.value) == 0) return false;
+            strcpy( s.value, value);
+            return true;
+        }
+
+        void emit( uint8_t index)
+        {
+            const signal &s = m_signals[index];
+            if (s.width == 1)
+            {
+                fprintf( m_out, "%s%c\n", s.value, identifier( index));
+            }
+            else
+            {
+                fprintf( m_out, "b%s %c\n", s.value, identifier( index));
+            }
+        }
+
+        FILE       *m_out;
+        const char *m_module;
+        signal      m_signals[max_signals];
+        uint8_t     m_count;
+        uint64_t    m_last_cycle;
+        bool        m_started;
+    };
+}
+
+/// add a pin or pin group to a vcd_writer, using the expression as signal name.
+#define VCD_SIGNAL( writer_, pin_) (writer_).add_signal( #pin_, pin_)
+
+#endif /* AVR_UTILITIES_SIMULATION_VCD_WRITER_HPP_ */
@@ -0,0 +1,237 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_SPSC_RING_HPP_
+#define AVR_UTILITIES_SPSC_RING_HPP_
+
+#include <stdint.h>
+
+#if defined(__AVR__)
+#   include <avr/io.h>
+#   include <avr/interrupt.h>
+#else
+#   include <atomic>
+#endif
+
+/**
+ * Single producer, single consumer ring buffer.
+ *
+ * Unlike round_robin_buffer, there is no shared 'full' flag: the write index is only ever
+ * written by the producer and the read index only by the consumer. The indices run freely
+ * and wrap at the range of their type, the number of elements in the ring is their difference.
+ * This is why the size of the ring must be a power of two.
+ *
+ * The third template argument determines how indices are published to the other side:
+ * - avr_ordering (the default on avr) uses volatile indices and compiler barriers. 16-bit
+ *   indices are read and written with interrupts disabled.
+ * - std_atomic_ordering (the default elsewhere) uses std::atomic with acquire/release
+ *   ordering, so that the ring can be used between threads on a host.
+ *
+ * Example:
+ * \code
+ * spsc::ring< 32> received;
+ *
+ * ISR( USART0_RX_vect)
+ * {
+ *     received.push( UDR0); // producer
+ * }
+ *
+ * uint8_t byte;
+ * if (received.pop( byte)) {...} // consumer
+ * \endcode
+ */
+namespace spsc
+{
+    namespace detail
+    {
+        /// free running indices must be able to count up to the size of the ring.
+        template< uint16_t buffer_size, bool fits_in_byte = (buffer_size <= 128)>
+        struct index_type
+        {
+            typedef uint8_t type;
+        };
+
+        template< uint16_t buffer_size>
+        struct index_type< buffer_size, false>
+        {
+            typedef uint16_t type;
+        };
+    }
+
+#if defined(__AVR__)
+    /// memory ordering for communication between interrupt handlers and the main program
+    /// on an avr.
+    struct avr_ordering
+    {
+        template< typename index_type>
+        class index
+        {
+        public:
+            index() : value( 0) {}
+
+            /// load by the side that owns this index. Only the owner writes the index, so
+            /// this cannot observe a half-written value.
+            index_type load_relaxed() const
+            {
+                return value;
+            }
+
+            /// load by the side that does not own this index. Data that the other side wrote
+            /// before publishing the index is visible after this call.
+            index_type load_acquire() const
+            {
+                index_type result;
+                if (sizeof( index_type) == 1)
+                {
+                    result = value;
+                }
+                else
+                {
+                    const uint8_t status = SREG;
+                    cli();
+                    result = value;
+                    SREG = status;
+                }
+                asm volatile( "" ::: "memory");
+                return result;
+            }
+
+            /// publish a new index value, after all data writes that precede it.
+            void store_release( index_type new_value)
+            {
+                asm volatile( "" ::: "memory");
+                if (sizeof( index_type) == 1)
+                {
+                    value = new_value;
+                }
+                else
+                {
+                    const uint8_t status = SREG;
+                    cli();
+                    value = new_value;
+                    SREG = status;
+                }
+            }
+
+        private:
+            volatile index_type value;
+        };
+    };
+
+    typedef avr_ordering default_ordering;
+#else
+    /// memory ordering for communication between threads, using std::atomic.
+    struct std_atomic_ordering
+    {
+        template< typename index_type>
+        class index
+        {
+        public:
+            index() : value( 0) {}
+
+            index_type load_relaxed() const
+            {
+                return value.load( std::memory_order_relaxed);
+            }
+
+            index_type load_acquire() const
+            {
+                return value.load( std::memory_order_acquire);
+            }
+
+            void store_release( index_type new_value)
+            {
+                value.store( new_value, std::memory_order_release);
+            }
+
+        private:
+            std::atomic< index_type> value;
+        };
+    };
+
+    typedef std_atomic_ordering default_ordering;
+#endif
+
+    template< uint16_t buffer_size, typename datatype = uint8_t, typename ordering = default_ordering>
+    class ring
+    {
+    public:
+        static_assert( buffer_size > 0 and (buffer_size & (buffer_size - 1)) == 0,
+                "the size of an spsc ring must be a power of two");
+
+        typedef datatype value_type;
+
+        typedef typename detail::index_type< buffer_size>::type index_type;
+
+        // producer side
+
+        /// add a value to the ring. Returns false if the ring is full.
+        bool push( const value_type &value)
+        {
+            const index_type write = write_index.load_relaxed();
+            if (static_cast<index_type>( write - read_index.load_acquire()) == buffer_size) return false;
+
+            buffer[write & mask] = value;
+            write_index.store_release( write + 1);
+            return true;
+        }
+
+        /// return the number of values that can be pushed.
+        index_type room() const
+        {
+            return buffer_size - static_cast<index_type>( write_index.load_relaxed() - read_index.load_acquire());
+        }
+
+        bool full() const
+        {
+            return room() == 0;
+        }
+
+        // consumer side
+
+        /// remove the oldest value from the ring. Returns false if the ring is empty.
+        bool pop( value_type &value)
+        {
+            const index_type read = read_index.load_relaxed();
+            if (read == write_index.load_acquire()) return false;
+
+            value = buffer[read & mask];
+            read_index.store_release( read + 1);
+            return true;
+        }
+
+        /// return a copy of the oldest value without removing it.
+        bool peek( value_type &value) const
+        {
+            const index_type read = read_index.load_relaxed();
+            if (read == write_index.load_acquire()) return false;
+
+            value = buffer[read & mask];
+            return true;
+        }
+
+        /// return the number of values that can be popped.
+        index_type size() const
+        {
+            return static_cast<index_type>( write_index.load_acquire() - read_index.load_relaxed());
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+    private:
+        static const index_type mask = buffer_size - 1;
+
+        typename ordering::template index< index_type> write_index; ///< owned by the producer
+        typename ordering::template index< index_type> read_index;  ///< owned by the consumer
+        value_type buffer[buffer_size];
+    };
+}
+
+#endif /* AVR_UTILITIES_SPSC_RING_HPP_ */
@@ -0,0 +1,53 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_TESTS_CHECK_HPP_
+#define AVR_UTILITIES_TESTS_CHECK_HPP_
+
+#include <stdio.h>
+
+/**
+ * Minimal test support for the host tests in this directory.
+ *
+ * A test is a function that uses CHECK() and CHECK_EQUAL(). main() runs the tests
+ * with RUN_TEST() and returns test_result(), which is non-zero if any check failed.
+ */
+namespace test
+{
+    inline unsigned &failures()
+    {
+        static unsigned count = 0;
+        return count;
+    }
+
+    inline void fail( const char *file, int line, const char *expression)
+    {
+        fprintf( stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++failures();
+    }
+}
+
+#define CHECK( condition_) \
+    ((condition_) ? (void)0 : test::fail( __FILE__, __LINE__, #condition_))
+
+#define CHECK_EQUAL( expected_, actual_) \
+    (((expected_) == (actual_)) ? (void)0 : test::fail( __FILE__, __LINE__, #expected_ " == " #actual_))
+
+#define RUN_TEST( test_) \
+    (printf( "%s\n", #test_), test_())
+
+inline int test_result()
+{
+    if (test::failures())
+    {
+        fprintf( stderr, "%u check(s) failed\n", test::failures());
+        return 1;
+    }
+    return 0;
+}
+
+#endif /* AVR_UTILITIES_TESTS_CHECK_HPP_ */
@@ -0,0 +1,19 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_TESTS_MOCK_AVR_INTERRUPT_H_
+#define AVR_UTILITIES_TESTS_MOCK_AVR_INTERRUPT_H_
+#include <avr/io.h>
+
+// the global interrupt flag is bit 7 of SREG, as on the mcu.
+#define cli() ((void)(SREG &= 0x7f))
+#define sei() ((void)(SREG |= 0x80))
+
+// an interrupt handler is an ordinary function that the test calls.
+#define ISR( vector_, ...) extern "C" void vector_( void); void vector_( void)
+
+#endif /* AVR_UTILITIES_TESTS_MOCK_AVR_INTERRUPT_H_ */
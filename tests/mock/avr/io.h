@@ -0,0 +1,150 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_TESTS_MOCK_AVR_IO_H_
+#define AVR_UTILITIES_TESTS_MOCK_AVR_IO_H_
+
+/**
+ * Stand-in for avr-libc's <avr/io.h> for the mock tests.
+ *
+ * The registers of an ATmega328P (ports B-D, the USART, timer 1 and the pin change interrupts)
+ * are plain bytes in host memory. The second USART of the ATmega328PB is there as well, for
+ * tests of uarts on other USARTs than USART 0.
+ * A test plays the part of the hardware and the interrupt controller: it reads and writes
+ * the registers directly and calls the interrupt handlers of a driver itself.
+ */
+
+#include <stdint.h>
+
+#if !defined(__AVR_ATmega328P__)
+#   define __AVR_ATmega328P__
+#endif
+
+namespace mock
+{
+    /// the simulated data memory below the internal RAM.
+    inline volatile uint8_t *memory()
+    {
+        alignas( 2) static volatile uint8_t registers[0x100];
+        return registers;
+    }
+}
+
+#define __SFR_OFFSET 0x20
+#define _MMIO_BYTE( mem_addr) (mock::memory()[mem_addr])
+#define _SFR_MEM8( mem_addr) _MMIO_BYTE( mem_addr)
+#define _SFR_IO8( io_addr) _MMIO_BYTE( (io_addr) + __SFR_OFFSET)
+#define _SFR_MEM16( mem_addr) (*reinterpret_cast< volatile uint16_t *>( mock::memory() + (mem_addr)))
+#define _BV( bit) (1 << (bit))
+
+#define PINB  _SFR_IO8( 0x03)
+#define DDRB  _SFR_IO8( 0x04)
+#define PORTB _SFR_IO8( 0x05)
+#define PINC  _SFR_IO8( 0x06)
+#define DDRC  _SFR_IO8( 0x07)
+#define PORTC _SFR_IO8( 0x08)
+#define PIND  _SFR_IO8( 0x09)
+#define DDRD  _SFR_IO8( 0x0A)
+#define PORTD _SFR_IO8( 0x0B)
+#define TIFR1 _SFR_IO8( 0x16)
+#define PCIFR _SFR_IO8( 0x1B)
+#define SREG  _SFR_IO8( 0x3F)
+
+#define PCICR  _SFR_MEM8( 0x68)
+#define PCMSK0 _SFR_MEM8( 0x6B)
+#define PCMSK1 _SFR_MEM8( 0x6C)
+#define PCMSK2 _SFR_MEM8( 0x6D)
+#define TIMSK1 _SFR_MEM8( 0x6F)
+
+#define TCCR1A _SFR_MEM8( 0x80)
+#define TCCR1B _SFR_MEM8( 0x81)
+#define TCNT1  _SFR_MEM16( 0x84)
+#define OCR1A  _SFR_MEM16( 0x88)
+#define OCR1B  _SFR_MEM16( 0x8A)
+
+#define PCIE0  0
+#define PCIE1  1
+#define PCIE2  2
+#define PCIF0  0
+#define PCIF1  1
+#define PCIF2  2
+
+#define CS10   0
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCF1A  1
+#define OCF1B  2
+
+#define UCSR0A _SFR_MEM8( 0xC0)
+#define UCSR0B _SFR_MEM8( 0xC1)
+#define UCSR0C _SFR_MEM8( 0xC2)
+#define UBRR0L _SFR_MEM8( 0xC4)
+#define UBRR0H _SFR_MEM8( 0xC5)
+#define UDR0   _SFR_MEM8( 0xC6)
+
+#define RXC0   7
+#define TXC0   6
+#define UDRE0  5
+#define FE0    4
+#define DOR0   3
+#define UPE0   2
+#define U2X0   1
+#define MPCM0  0
+
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0  4
+#define TXEN0  3
+#define UCSZ02 2
+#define RXB80  1
+#define TXB80  0
+
+#define UCSZ01 2
+#define UCSZ00 1
+
+#define UCSR1A _SFR_MEM8( 0xC8)
+#define UCSR1B _SFR_MEM8( 0xC9)
+#define UCSR1C _SFR_MEM8( 0xCA)
+#define UBRR1L _SFR_MEM8( 0xCC)
+#define UBRR1H _SFR_MEM8( 0xCD)
+#define UDR1   _SFR_MEM8( 0xCE)
+
+#define RXC1   7
+#define TXC1   6
+#define UDRE1  5
+#define FE1    4
+#define DOR1   3
+#define UPE1   2
+#define U2X1   1
+#define MPCM1  0
+
+#define RXCIE1 7
+#define TXCIE1 6
+#define UDRIE1 5
+#define RXEN1  4
+#define TXEN1  3
+#define UCSZ12 2
+#define RXB81  1
+#define TXB81  0
+
+#define UCSZ11 2
+#define UCSZ10 1
+
+#define PCINT0_vect       __vector_3
+#define PCINT1_vect       __vector_4
+#define PCINT2_vect       __vector_5
+#define TIMER1_COMPA_vect __vector_11
+#define TIMER1_COMPB_vect __vector_12
+#define USART_RX_vect     __vector_18
+#define USART_UDRE_vect   __vector_19
+#define USART_TX_vect     __vector_20
+#define USART1_RX_vect    __vector_28
+#define USART1_UDRE_vect  __vector_29
+#define USART1_TX_vect    __vector_30
+
+#endif /* AVR_UTILITIES_TESTS_MOCK_AVR_IO_H_ */
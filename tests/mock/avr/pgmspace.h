@@ -0,0 +1,20 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef AVR_UTILITIES_TESTS_MOCK_AVR_PGMSPACE_H_
+#define AVR_UTILITIES_TESTS_MOCK_AVR_PGMSPACE_H_
+#include <stdint.h>
+#include <string.h>
+
+// flash memory is ordinary memory on the host.
+#define PROGMEM
+#define PSTR( string_) (string_)
+#define pgm_read_byte( address_) (*(const uint8_t *)(address_))
+#define pgm_read_word( address_) (*(const uint16_t *)(address_))
+#define strlen_P( string_) strlen( string_)
+
+#endif /* AVR_UTILITIES_TESTS_MOCK_AVR_PGMSPACE_H_ */
@@ -0,0 +1,121 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/pin_array.hpp"
+#include "check.hpp"
+
+using namespace pin_definitions;
+
+namespace
+{
+    typedef pin_array< PIN_TYPE( B, 0), PIN_TYPE( D, 5), PIN_TYPE( C, 2), PIN_TYPE( H, 7)> columns_type;
+    columns_type columns;
+
+    uint8_t value_at( uint16_t address)
+    {
+        return simulation::register_file::instance().peek( address);
+    }
+
+    const uint16_t port_b = port_traits< port_B>::port_address;
+    const uint16_t port_c = port_traits< port_C>::port_address;
+    const uint16_t port_d = port_traits< port_D>::port_address;
+    const uint16_t port_h = port_traits< port_H>::port_address;
+
+    /// the table holds the PINx address and the mask of every pin, in order.
+    void test_table()
+    {
+        CHECK_EQUAL( 4, columns_type::size);
+        CHECK_EQUAL( port_traits< port_D>::pin_address, columns_type::table[1].pin_address);
+        CHECK_EQUAL( _BV( 5), columns_type::table[1].mask);
+        CHECK_EQUAL( port_traits< port_H>::pin_address, columns_type::table[3].pin_address);
+        CHECK_EQUAL( _BV( 7), columns_type::table[3].mask);
+    }
+
+    /// indexed operations change only the pin at that index.
+    void test_set_and_reset()
+    {
+        simulation::register_file::instance().reset();
+        PORTD = _BV( 0);
+        for (uint8_t column = 0; column < columns_type::size; ++column)
+        {
+            set( columns, column);
+        }
+        CHECK_EQUAL( _BV( 0), value_at( port_b));
+        CHECK_EQUAL( _BV( 5) | _BV( 0), value_at( port_d));
+        CHECK_EQUAL( _BV( 2), value_at( port_c));
+        CHECK_EQUAL( _BV( 7), value_at( port_h));
+
+        reset( columns, 1);
+        CHECK_EQUAL( _BV( 0), value_at( port_d));
+        clear( columns, 3);
+        CHECK_EQUAL( 0, value_at( port_h));
+
+        write( columns, 3, true);
+        CHECK_EQUAL( _BV( 7), value_at( port_h));
+        write( columns, 0, false);
+        CHECK_EQUAL( 0, value_at( port_b));
+    }
+
+    /// toggle() writes the mask to PINx, which toggles the output.
+    void test_toggle()
+    {
+        simulation::register_file::instance().reset();
+        toggle( columns, 2);
+        CHECK_EQUAL( _BV( 2), value_at( port_c));
+        toggle( columns, 2);
+        CHECK_EQUAL( 0, value_at( port_c));
+    }
+
+    /// read() returns the driven level of an input pin.
+    void test_read()
+    {
+        simulation::register_file &registers = simulation::register_file::instance();
+        registers.reset();
+        CHECK( not read( columns, 1));
+        registers.drive( port_traits< port_D>::pin_address, _BV( 5), true);
+        CHECK( read( columns, 1));
+        CHECK( not read( columns, 0));
+    }
+
+    void test_direction()
+    {
+        simulation::register_file::instance().reset();
+        make_output( columns, 1);
+        make_output( columns, 3);
+        CHECK_EQUAL( _BV( 5), value_at( port_traits< port_D>::ddr_address));
+        CHECK_EQUAL( _BV( 7), value_at( port_traits< port_H>::ddr_address));
+        make_input( columns, 1);
+        CHECK_EQUAL( 0, value_at( port_traits< port_D>::ddr_address));
+    }
+
+    /// a pin_array is a list of pins, with the first pin as the least significant bit.
+    void test_as_list()
+    {
+        simulation::register_file::instance().reset();
+        make_output( columns);
+        CHECK_EQUAL( _BV( 0), value_at( port_traits< port_B>::ddr_address));
+        CHECK_EQUAL( _BV( 7), value_at( port_traits< port_H>::ddr_address));
+
+        write( columns, 0x05);
+        CHECK_EQUAL( _BV( 0), value_at( port_b));
+        CHECK_EQUAL( 0, value_at( port_d));
+        CHECK_EQUAL( _BV( 2), value_at( port_c));
+        CHECK_EQUAL( 0, value_at( port_h));
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_table);
+    RUN_TEST( test_set_and_reset);
+    RUN_TEST( test_toggle);
+    RUN_TEST( test_read);
+    RUN_TEST( test_direction);
+    RUN_TEST( test_as_list);
+
+    return test_result();
+}
@@ -0,0 +1,116 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/pin_change_interrupt.hpp"
+#include "check.hpp"
+
+namespace
+{
+    /// the number of calls and the last level that a handler received.
+    struct calls
+    {
+        int  count;
+        bool level;
+    };
+
+    calls button_calls;
+    calls encoder_a_calls;
+    calls encoder_b_calls;
+
+    void record( calls &c, bool level)
+    {
+        ++c.count;
+        c.level = level;
+    }
+
+    void on_button( bool level)    { record( button_calls, level);}
+    void on_encoder_a( bool level) { record( encoder_a_calls, level);}
+    void on_encoder_b( bool level) { record( encoder_b_calls, level);}
+
+    typedef pin_definitions::cons<
+            pin_change::handler< PIN_TYPE( B, 0), on_button>,
+            pin_definitions::cons<
+            pin_change::handler< PIN_TYPE( D, 3), on_encoder_a>,
+            pin_definitions::cons<
+            pin_change::handler< PIN_TYPE( D, 4), on_encoder_b> > > > handlers;
+}
+
+IMPLEMENT_PIN_CHANGE_INTERRUPTS( handlers)
+
+namespace
+{
+    void clear_calls()
+    {
+        button_calls = calls();
+        encoder_a_calls = calls();
+        encoder_b_calls = calls();
+    }
+
+    /// init() enables exactly the pins of the handlers and the groups of their ports.
+    void test_init()
+    {
+        PINB = 0;
+        PIND = _BV( 4);
+        pin_change::dispatcher< handlers>::init();
+
+        CHECK_EQUAL( _BV( 0), PCMSK0);
+        CHECK_EQUAL( 0, PCMSK1);
+        CHECK_EQUAL( _BV( 3) | _BV( 4), PCMSK2);
+        CHECK_EQUAL( _BV( PCIE0) | _BV( PCIE2), PCICR);
+    }
+
+    /// only the handlers of pins that changed are called, with the new level of their pin.
+    void test_dispatch_per_pin()
+    {
+        clear_calls();
+        PIND = _BV( 4) | _BV( 3);
+        PCINT2_vect();
+        CHECK_EQUAL( 1, encoder_a_calls.count);
+        CHECK( encoder_a_calls.level);
+        CHECK_EQUAL( 0, encoder_b_calls.count);
+        CHECK_EQUAL( 0, button_calls.count);
+
+        // both encoder pins change in one interrupt.
+        clear_calls();
+        PIND = 0;
+        PCINT2_vect();
+        CHECK_EQUAL( 1, encoder_a_calls.count);
+        CHECK( not encoder_a_calls.level);
+        CHECK_EQUAL( 1, encoder_b_calls.count);
+        CHECK( not encoder_b_calls.level);
+
+        clear_calls();
+        PINB = _BV( 0);
+        PCINT0_vect();
+        CHECK_EQUAL( 1, button_calls.count);
+        CHECK( button_calls.level);
+        CHECK_EQUAL( 0, encoder_a_calls.count);
+    }
+
+    /// changes of pins without a handler, or an interrupt without a change, call nothing.
+    void test_no_change()
+    {
+        clear_calls();
+        PIND = _BV( 0) | _BV( 7);
+        PCINT2_vect();
+        PINB = _BV( 0) | _BV( 5);
+        PCINT0_vect();
+        PCINT1_vect();
+        CHECK_EQUAL( 0, button_calls.count);
+        CHECK_EQUAL( 0, encoder_a_calls.count);
+        CHECK_EQUAL( 0, encoder_b_calls.count);
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_init);
+    RUN_TEST( test_dispatch_per_pin);
+    RUN_TEST( test_no_change);
+
+    return test_result();
+}
@@ -0,0 +1,281 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/pin_definitions.hpp"
+#include "check.hpp"
+
+using namespace pin_definitions;
+
+namespace
+{
+    typedef simulation::recorder<> recorder_type;
+
+    /// run a function and return the number of register accesses that it made.
+    template< typename function>
+    uint32_t count_accesses( function f, recorder_type &r)
+    {
+        simulation::register_file::instance().reset();
+        r.clear();
+        simulation::register_file::instance().set_observer( &r);
+        f();
+        simulation::register_file::instance().set_observer( 0);
+        return r.count();
+    }
+
+    bool touches_sreg( const recorder_type &r)
+    {
+        for (uint32_t index = 0; index < r.count(); ++index)
+        {
+            if (r[index].address == 0x5F) return true;
+        }
+        return false;
+    }
+
+    DECLARE_PIN( led, B, 3)
+    DECLARE_PIN_GROUP( nibble, B, 4, 4)
+
+    // the bits of a number, spread over several ports.
+    DECLARE_PIN( d0, C, 0)
+    DECLARE_PIN( d1, D, 7)
+    DECLARE_PIN( d2, B, 2)
+    DECLARE_PIN( d3, D, 1)
+
+    uint8_t port_value( uint16_t port_address)
+    {
+        return simulation::register_file::instance().peek( port_address);
+    }
+
+    /// the right-most pin of an operator| expression is the head of the list and
+    /// receives the least significant bit, just like the last pin given to list_of().
+    void test_list_bit_order()
+    {
+        simulation::register_file::instance().reset();
+        write( d3 | d2 | d1 | d0, 5);
+        CHECK_EQUAL( _BV( 0), port_value( port_traits< port_C>::port_address));
+        CHECK_EQUAL( _BV( 2), port_value( port_traits< port_B>::port_address));
+        CHECK_EQUAL( 0, port_value( port_traits< port_D>::port_address));
+
+        simulation::register_file::instance().reset();
+        write( list_of( d3)( d2)( d1)( d0), 5);
+        CHECK_EQUAL( _BV( 0), port_value( port_traits< port_C>::port_address));
+        CHECK_EQUAL( _BV( 2), port_value( port_traits< port_B>::port_address));
+        CHECK_EQUAL( 0, port_value( port_traits< port_D>::port_address));
+
+        simulation::register_file::instance().reset();
+        write( d3 | d2 | d1 | d0, 0x0a);
+        CHECK_EQUAL( 0, port_value( port_traits< port_C>::port_address));
+        CHECK_EQUAL( 0, port_value( port_traits< port_B>::port_address));
+        CHECK_EQUAL( _BV( 7) | _BV( 1), port_value( port_traits< port_D>::port_address));
+
+        // a list of two pins.
+        simulation::register_file::instance().reset();
+        write( d1 | d0, 1);
+        CHECK_EQUAL( _BV( 0), port_value( port_traits< port_C>::port_address));
+        CHECK_EQUAL( 0, port_value( port_traits< port_D>::port_address));
+    }
+
+    void read_number() { CHECK_EQUAL( 5u, read( d3 | d2 | d1 | d0));}
+
+    /// read() of a list gathers the bits with one read per port, in the same order as
+    /// write() uses. is_set() tells whether any of the pins is high.
+    void test_list_read()
+    {
+        simulation::register_file &registers = simulation::register_file::instance();
+        static recorder_type r;
+
+        registers.reset();
+        registers.drive( port_traits< port_C>::pin_address, _BV( 0), true);
+        registers.drive( port_traits< port_B>::pin_address, _BV( 2), true);
+        r.clear();
+        registers.set_observer( &r);
+        read_number();
+        registers.set_observer( 0);
+        CHECK_EQUAL( 3u, r.count());
+        CHECK( is_set( d3 | d2 | d1 | d0));
+        CHECK( not is_set( d3 | d1));
+
+        // a pin group takes as many bits as it is wide.
+        registers.reset();
+        registers.drive( port_traits< port_B>::pin_address, 0xa8, true);
+        CHECK_EQUAL( 0x15u, read( nibble | led));
+
+        // pins that are outputs read back their output value.
+        registers.reset();
+        make_output( d3 | d2 | d1 | d0);
+        write( d3 | d2 | d1 | d0, 0x0b);
+        CHECK_EQUAL( 0x0bu, read( d3 | d2 | d1 | d0));
+    }
+
+    DECLARE_PIN( h5, H, 5)
+
+    void assign_pins() { assign( d2 | d0 | led, d1 | d3 | nibble);}
+
+    /// assign() sets and resets pins with one read-modify-write per port.
+    void test_assign()
+    {
+        static recorder_type r;
+        simulation::register_file &registers = simulation::register_file::instance();
+
+        count_accesses( []{ PORTB = 0xf0; PORTD = 0xff;}, r);
+        registers.set_observer( &r);
+        r.clear();
+        assign_pins();
+        registers.set_observer( 0);
+
+        CHECK_EQUAL( 6u, r.count()); // ports B, C and D
+        CHECK_EQUAL( _BV( 2) | _BV( 3), port_value( port_traits< port_B>::port_address));
+        CHECK_EQUAL( _BV( 0), port_value( port_traits< port_C>::port_address));
+        CHECK_EQUAL( 0x7d, port_value( port_traits< port_D>::port_address));
+
+        // a pin in both arguments is set.
+        assign( led, led);
+        CHECK( port_value( port_traits< port_B>::port_address) & _BV( 3));
+    }
+
+    bool only_touches( const recorder_type &r, uint16_t address)
+    {
+        for (uint32_t index = 0; index < r.count(); ++index)
+        {
+            if (r[index].address != address) return false;
+        }
+        return r.count() != 0;
+    }
+
+    /// a single pin on a bit addressable port is changed with SBI or CBI, which the simulation
+    /// records as one read and one write of the port register, without touching SREG.
+    void test_atomic_single_pin()
+    {
+        static recorder_type r;
+        const uint16_t port_b = port_traits< port_B>::port_address;
+
+        CHECK_EQUAL( 2u, count_accesses( []{ atomic_set( led);}, r));
+        CHECK( only_touches( r, port_b));
+        CHECK_EQUAL( _BV( 3), port_value( port_b));
+
+        // the assignment to PORTB is the first access.
+        CHECK_EQUAL( 3u, count_accesses( []{ PORTB = 0xff; atomic_reset( led);}, r));
+        CHECK( only_touches( r, port_b));
+        CHECK_EQUAL( 0xf7, port_value( port_b));
+
+        CHECK_EQUAL( 2u, count_accesses( []{ atomic_clear( led);}, r));
+        CHECK( only_touches( r, port_b));
+    }
+
+    /// check that the operation disables interrupts around its read-modify-write and
+    /// restores the interrupt flag afterwards, whatever its value was.
+    template< typename function>
+    void check_guarded( function f, uint32_t ports)
+    {
+        static recorder_type r;
+        simulation::register_file &registers = simulation::register_file::instance();
+        const uint8_t statuses[] = { 0x00, 0x80};
+        for (uint8_t status : statuses)
+        {
+            registers.reset();
+            SREG = status;
+            r.clear();
+            registers.set_observer( &r);
+            f();
+            registers.set_observer( 0);
+
+            // per port: save SREG, cli() (a read and a write of SREG), read and write
+            // the port and restore SREG.
+            CHECK_EQUAL( 6 * ports, r.count());
+            CHECK_EQUAL( status, registers.peek( 0x5F));
+            for (uint32_t index = 0; index < r.count(); index += 6)
+            {
+                CHECK_EQUAL( 0x5F, r[index].address);
+                CHECK_EQUAL( 0x5F, r[index + 2].address);
+                CHECK( r[index + 2].is_write);
+                CHECK_EQUAL( 0, r[index + 2].value & 0x80);
+                CHECK( r[index + 3].address != 0x5F);
+                CHECK_EQUAL( r[index + 3].address, r[index + 4].address);
+                CHECK_EQUAL( 0x5F, r[index + 5].address);
+                CHECK( r[index + 5].is_write);
+            }
+        }
+    }
+
+    /// pins on ports that are not bit addressable, and several pins on one port, are
+    /// changed with interrupts disabled.
+    void test_atomic_guarded()
+    {
+        check_guarded( []{ atomic_set( h5);}, 1);
+        CHECK_EQUAL( _BV( 5), port_value( port_traits< port_H>::port_address));
+        check_guarded( []{ atomic_reset( h5);}, 1);
+        check_guarded( []{ atomic_write( h5, 1);}, 1);
+        CHECK_EQUAL( _BV( 5), port_value( port_traits< port_H>::port_address));
+
+        check_guarded( []{ atomic_set( led | d2);}, 1);
+        CHECK_EQUAL( _BV( 2) | _BV( 3), port_value( port_traits< port_B>::port_address));
+        check_guarded( []{ atomic_reset( d3 | d1);}, 1);
+        check_guarded( []{ atomic_write( d3 | d2 | d1 | d0, 0x0f);}, 3);
+        CHECK_EQUAL( _BV( 7) | _BV( 1), port_value( port_traits< port_D>::port_address));
+
+        // in a list, a port with only one of the pins still gets a plain SBI or CBI.
+        static recorder_type r;
+        CHECK_EQUAL( 10u, count_accesses( []{ atomic_reset( d3 | d2 | d1 | d0);}, r));
+        CHECK_EQUAL( port_traits< port_C>::port_address, r[0].address);
+        CHECK_EQUAL( port_traits< port_C>::port_address, r[1].address);
+        CHECK_EQUAL( 0x5F, r[2].address);
+        CHECK_EQUAL( port_traits< port_D>::port_address, r[5].address);
+        CHECK_EQUAL( 0x5F, r[7].address);
+        CHECK_EQUAL( port_traits< port_B>::port_address, r[8].address);
+        CHECK_EQUAL( port_traits< port_B>::port_address, r[9].address);
+    }
+
+    void write_int_one()    { atomic_write( led, 1);}
+    void write_int_zero()   { atomic_write( led, 0);}
+    void write_bool()       { atomic_write( led, true);}
+    void write_large()      { atomic_write( led, 256);}
+    void plain_set()        { atomic_set( led);}
+    void plain_reset()      { atomic_reset( led);}
+    void write_group()      { atomic_write( nibble, 5);}
+
+    /// atomic_write() of a single pin must use the same code path as atomic_set() and
+    /// atomic_reset(), whatever the type of the value.
+    void test_atomic_write_single_pin()
+    {
+        static recorder_type r;
+        const uint32_t set_count = count_accesses( plain_set, r);
+        const uint32_t reset_count = count_accesses( plain_reset, r);
+
+        CHECK_EQUAL( set_count, count_accesses( write_int_one, r));
+        CHECK( not touches_sreg( r));
+        CHECK( simulation::register_file::instance().peek( port_traits< port_B>::port_address) & _BV( 3));
+
+        CHECK_EQUAL( reset_count, count_accesses( write_int_zero, r));
+        CHECK( not touches_sreg( r));
+
+        CHECK_EQUAL( set_count, count_accesses( write_bool, r));
+
+        // a value that does not fit in a byte is still non-zero.
+        CHECK_EQUAL( set_count, count_accesses( write_large, r));
+        CHECK( simulation::register_file::instance().peek( port_traits< port_B>::port_address) & _BV( 3));
+    }
+
+    /// pin groups still take the interrupt guarded read-modify-write.
+    void test_atomic_write_group()
+    {
+        static recorder_type r;
+        count_accesses( write_group, r);
+        CHECK( touches_sreg( r));
+        CHECK_EQUAL( 0x50, simulation::register_file::instance().peek( port_traits< port_B>::port_address));
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_atomic_write_single_pin);
+    RUN_TEST( test_atomic_write_group);
+    RUN_TEST( test_list_bit_order);
+    RUN_TEST( test_list_read);
+    RUN_TEST( test_assign);
+    RUN_TEST( test_atomic_single_pin);
+    RUN_TEST( test_atomic_guarded);
+    return test_result();
+}
@@ -0,0 +1,19 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+// This file must not compile: a transaction only accepts pins on its own ports.
+// expected error: pins must be on ports that are part of the transaction
+#include "avr_utilities/port_transaction.hpp"
+
+using namespace pin_definitions;
+
+int main()
+{
+    port_transaction< PIN_TYPE( B, 1)> transaction;
+    transaction.set( PIN_TYPE( C, 0)());
+    return 0;
+}
@@ -0,0 +1,121 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/port_transaction.hpp"
+#include "check.hpp"
+
+using namespace pin_definitions;
+
+namespace
+{
+    typedef simulation::recorder<> recorder_type;
+
+    DECLARE_PIN( clk, B, 1)
+    DECLARE_PIN( data, D, 2)
+    DECLARE_PIN_GROUP( nibble, D, 4, 4)
+
+    typedef port_transaction< PIN_TYPE( B, 1), PIN_TYPE( D, 2), PIN_TYPE( D, 3), PIN_GROUP_TYPE( D, 4, 4)> transaction_type;
+
+    simulation::register_file &registers()
+    {
+        return simulation::register_file::instance();
+    }
+
+    uint8_t port_b() { return registers().peek( port_traits< port_B>::port_address);}
+    uint8_t port_d() { return registers().peek( port_traits< port_D>::port_address);}
+
+    /// constructing a transaction reads each output register once, changes only affect the
+    /// shadow copies and commit() writes each port once.
+    void test_load_and_store()
+    {
+        static recorder_type r;
+        registers().reset();
+        PORTB = 0x80;
+        PORTD = 0x01;
+
+        registers().set_observer( &r);
+        transaction_type transaction;
+        CHECK_EQUAL( 2u, r.count());
+        CHECK( not r[0].is_write);
+        CHECK( not r[1].is_write);
+
+        r.clear();
+        transaction.set( clk);
+        transaction.reset( data);
+        transaction.write( nibble, 0x0a);
+        CHECK_EQUAL( 0u, r.count());
+
+        transaction.commit();
+        registers().set_observer( 0);
+        CHECK_EQUAL( 2u, r.count());
+        CHECK( r[0].is_write);
+        CHECK( r[1].is_write);
+        CHECK_EQUAL( 0x82, port_b());
+        CHECK_EQUAL( 0xa1, port_d());
+    }
+
+    /// refresh() reads the output registers again.
+    void test_refresh()
+    {
+        registers().reset();
+        transaction_type transaction;
+        PORTB = 0x40;
+        transaction.set( clk);
+        transaction.commit();
+        CHECK_EQUAL( 0x02, port_b()); // the shadow copy did not see 0x40
+
+        PORTB = 0x40;
+        transaction.refresh();
+        transaction.set( clk);
+        transaction.commit();
+        CHECK_EQUAL( 0x42, port_b());
+    }
+
+    /// writing a single pin sets it for any non-zero value, like the free write().
+    void test_write_single_pin()
+    {
+        registers().reset();
+        transaction_type transaction;
+        transaction.write( data, 2);
+        transaction.commit();
+        CHECK_EQUAL( _BV( 2), port_d());
+
+        transaction.write( data, 0);
+        transaction.commit();
+        CHECK_EQUAL( 0, port_d());
+
+        write( data, 2);
+        CHECK_EQUAL( _BV( 2), port_d());
+    }
+
+    /// writing a list uses the same bit order as the free write() for lists.
+    void test_write_list()
+    {
+        registers().reset();
+        write( clk | data | PIN_TYPE( D, 3)(), 5);
+        const uint8_t expected_b = port_b();
+        const uint8_t expected_d = port_d();
+
+        registers().reset();
+        transaction_type transaction;
+        transaction.write( clk | data | PIN_TYPE( D, 3)(), 5);
+        transaction.commit();
+        CHECK_EQUAL( expected_b, port_b());
+        CHECK_EQUAL( expected_d, port_d());
+        CHECK_EQUAL( _BV( 1), port_b());
+        CHECK_EQUAL( _BV( 3), port_d());
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_load_and_store);
+    RUN_TEST( test_refresh);
+    RUN_TEST( test_write_single_pin);
+    RUN_TEST( test_write_list);
+    return test_result();
+}
@@ -0,0 +1,112 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/pulse_train.hpp"
+#include "check.hpp"
+
+using namespace pin_definitions;
+
+namespace
+{
+    typedef simulation::recorder<> recorder_type;
+
+    typedef PIN_TYPE( B, 1) data_type;
+    typedef PIN_TYPE( B, 2) clock_type;
+
+    typedef pulse_train<
+            set_step< data_type, 13>,
+            reset_step< data_type, 7>,
+            step< clock_type, data_type, 4>,
+            step< data_type, clock_type, 2>
+        > train_type;
+
+    const uint16_t port_b = port_traits< port_B>::port_address;
+
+    /// play a train with the register file recording and collect the values and cycles of
+    /// the port writes.
+    template< typename train>
+    uint8_t play( recorder_type &r, uint8_t *values, uint64_t *cycles, uint8_t size)
+    {
+        r.clear();
+        simulation::register_file::instance().set_observer( &r);
+        train::play();
+        simulation::register_file::instance().set_observer( 0);
+
+        uint8_t count = 0;
+        for (uint32_t index = 0; index < r.count() && count < size; ++index)
+        {
+            if (r[index].address == port_b && r[index].is_write)
+            {
+                values[count] = r[index].value;
+                cycles[count] = r[index].cycle;
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    /// every step writes the port once, the step's number of cycles after the previous one,
+    /// and pins that are not part of the train keep their value.
+    void test_steps()
+    {
+        static recorder_type r;
+        simulation::register_file::instance().reset();
+        PORTB = 0x81;
+
+        uint8_t values[8];
+        uint64_t cycles[8];
+        CHECK_EQUAL( 4, play< train_type>( r, values, cycles, 8));
+
+        CHECK_EQUAL( 0x83, values[0]);
+        CHECK_EQUAL( 0x81, values[1]);
+        CHECK_EQUAL( 0x85, values[2]);
+        CHECK_EQUAL( 0x83, values[3]);
+
+        CHECK_EQUAL( 13u, cycles[1] - cycles[0]);
+        CHECK_EQUAL( 7u,  cycles[2] - cycles[1]);
+        CHECK_EQUAL( 4u,  cycles[3] - cycles[2]);
+        CHECK_EQUAL( 0x83, simulation::register_file::instance().peek( port_b));
+    }
+
+    /// the port is read once, before the first write, and interrupts are disabled while
+    /// the train plays and restored afterwards.
+    void test_interrupts_and_reads()
+    {
+        static recorder_type r;
+        simulation::register_file &registers = simulation::register_file::instance();
+        registers.reset();
+        SREG = 0x80;
+
+        uint8_t values[8];
+        uint64_t cycles[8];
+        play< train_type>( r, values, cycles, 8);
+
+        uint8_t port_reads = 0;
+        bool interrupts_enabled = true;
+        for (uint32_t index = 0; index < r.count(); ++index)
+        {
+            const simulation::access &a = r[index];
+            if (a.address == 0x5F && a.is_write) interrupts_enabled = a.value & 0x80;
+            if (a.address == port_b)
+            {
+                CHECK( not interrupts_enabled);
+                if (not a.is_write) ++port_reads;
+            }
+        }
+        CHECK_EQUAL( 1, port_reads);
+        CHECK( interrupts_enabled);
+        CHECK_EQUAL( 0x80, registers.peek( 0x5F));
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_steps);
+    RUN_TEST( test_interrupts_and_reads);
+
+    return test_result();
+}
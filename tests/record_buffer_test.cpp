@@ -0,0 +1,91 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/record_buffer.hpp"
+#include "check.hpp"
+
+namespace
+{
+    /// a record that is still being built is invisible to the consumer, even when it
+    /// fills the buffer.
+    void test_uncommitted_record_fills_buffer()
+    {
+        static record_buffer< 8> records;
+        const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7};
+
+        CHECK( records.begin_record());
+        CHECK( records.append( data, sizeof data));
+        CHECK( not records.append( 8));
+
+        record_buffer< 8>::record r;
+        CHECK( not records.peek_record( r));
+        CHECK( records.empty());
+
+        CHECK( records.commit_record());
+        CHECK( records.peek_record( r));
+        CHECK_EQUAL( 7u, r.length);
+        CHECK_EQUAL( 7u, r[6]);
+    }
+
+    /// appending more bytes than the buffer can hold fails and stores nothing, also
+    /// when the count does not fit in the index type of the buffer.
+    void test_append_too_many()
+    {
+        typedef record_buffer< 64, uint16_t> buffer_type;
+        static buffer_type records;
+        static const uint8_t data[300] = {};
+
+        CHECK( records.begin_record());
+        CHECK( not records.append( data, 300));
+        CHECK( not records.append( data, 63));
+        CHECK( records.append( data, 62));
+        CHECK( records.commit_record());
+
+        buffer_type::record r;
+        CHECK( records.peek_record( r));
+        CHECK_EQUAL( 62u, r.length);
+    }
+
+    /// records that wrap around the end of the buffer are presented in two parts.
+    void test_wrapping_record()
+    {
+        static record_buffer< 8> records;
+        const uint8_t data[] = { 1, 2, 3, 4, 5};
+        record_buffer< 8>::record r;
+
+        CHECK( records.begin_record());
+        CHECK( records.append( data, 4));
+        CHECK( records.commit_record());
+        records.pop_record();
+        CHECK( records.empty());
+
+        CHECK( records.begin_record());
+        CHECK( records.append( data, sizeof data));
+        CHECK( records.commit_record());
+        CHECK( records.peek_record( r));
+        CHECK_EQUAL( 5u, r.length);
+        CHECK_EQUAL( 2u, r.first_length);
+
+        uint8_t copy[sizeof data];
+        r.copy_to( copy);
+        for (uint8_t index = 0; index < sizeof data; ++index)
+        {
+            CHECK_EQUAL( data[index], copy[index]);
+            CHECK_EQUAL( data[index], r[index]);
+        }
+        records.pop_record();
+        CHECK( records.empty());
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_uncommitted_record_fills_buffer);
+    RUN_TEST( test_append_too_many);
+    RUN_TEST( test_wrapping_record);
+    return test_result();
+}
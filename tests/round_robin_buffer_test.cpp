@@ -0,0 +1,251 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/round_robin_buffer.h"
+#include "check.hpp"
+
+namespace
+{
+    /// buffers of 256 values and more use 16-bit indices. Run values through such a
+    /// buffer often enough to wrap around its end a few times.
+    void test_16_bit_indices()
+    {
+        static round_robin_buffer< 300> buffer;
+        CHECK_EQUAL( 2u, sizeof( round_robin_buffer< 300>::index_type));
+
+        uint8_t expected = 0;
+        uint8_t next = 0;
+        for (int round = 0; round < 10; ++round)
+        {
+            for (int count = 0; count < 250; ++count)
+            {
+                CHECK( buffer.write_tentative( next++));
+            }
+            buffer.commit();
+            CHECK_EQUAL( 250u, buffer.size());
+
+            uint8_t value;
+            while (buffer.read( &value))
+            {
+                CHECK_EQUAL( expected, value);
+                ++expected;
+            }
+        }
+        CHECK( buffer.empty());
+    }
+
+    /// values that fill the buffer but are not committed yet are invisible to the reader.
+    void test_tentative_fill_is_not_committed()
+    {
+        static round_robin_buffer< 4> buffer;
+        for (uint8_t value = 1; value <= 4; ++value)
+        {
+            CHECK( buffer.write_tentative( value));
+        }
+        CHECK( buffer.full());
+        CHECK( buffer.empty());
+        CHECK_EQUAL( 0u, buffer.size());
+        CHECK_EQUAL( 0u, buffer.committed());
+
+        uint8_t value;
+        CHECK( not buffer.read( &value));
+        const uint8_t *region;
+        CHECK_EQUAL( 0u, buffer.peek_span( region));
+
+        CHECK_EQUAL( 4u, buffer.commit());
+        CHECK_EQUAL( 4u, buffer.size());
+        CHECK_EQUAL( 0u, buffer.commit());
+        CHECK_EQUAL( 4u, buffer.peek_span( region));
+        CHECK( buffer.read( &value));
+        CHECK_EQUAL( 1u, value);
+        CHECK_EQUAL( 3u, buffer.size());
+    }
+
+    /// resetting a tentative write that filled the buffer makes room again.
+    void test_reset_tentative_fill()
+    {
+        static round_robin_buffer< 4> buffer;
+        CHECK( buffer.write_tentative( 1));
+        buffer.commit();
+        for (uint8_t value = 2; value <= 4; ++value)
+        {
+            CHECK( buffer.write_tentative( value));
+        }
+        CHECK( buffer.full());
+        buffer.reset_tentative();
+        CHECK( not buffer.full());
+        CHECK_EQUAL( 3u, buffer.available());
+        CHECK_EQUAL( 1u, buffer.size());
+    }
+
+    typedef round_robin_buffer< 4, uint8_t, round_robin_policy::overwrite_oldest> overwriting_buffer;
+
+    /// the overwrite policy never drops uncommitted values.
+    void test_overwrite_keeps_uncommitted_values()
+    {
+        static overwriting_buffer buffer;
+        for (uint8_t value = 1; value <= 4; ++value)
+        {
+            CHECK( buffer.write_tentative( value));
+        }
+        CHECK( not buffer.write_tentative( 5));
+        CHECK_EQUAL( 0u, buffer.overwritten());
+
+        uint8_t value;
+        CHECK( not buffer.read( &value));
+
+        buffer.commit();
+        CHECK( buffer.read( &value));
+        CHECK_EQUAL( 1u, value);
+    }
+
+    /// when the buffer is full of committed values, the oldest ones are overwritten.
+    void test_overwrite_committed_values()
+    {
+        static overwriting_buffer buffer;
+        for (uint8_t value = 1; value <= 4; ++value)
+        {
+            CHECK( buffer.write_tentative( value));
+        }
+        buffer.commit();
+        CHECK( buffer.write_tentative( 5));
+        buffer.commit();
+        CHECK_EQUAL( 1u, buffer.overwritten());
+        CHECK_EQUAL( 4u, buffer.size());
+
+        for (uint8_t expected = 2; expected <= 5; ++expected)
+        {
+            uint8_t value = 0;
+            CHECK( buffer.read( &value));
+            CHECK_EQUAL( expected, value);
+        }
+        CHECK( buffer.empty());
+    }
+
+    /// with some values committed and the rest of the buffer filled tentatively, only the
+    /// committed values can be overwritten.
+    void test_overwrite_partly_committed()
+    {
+        static overwriting_buffer buffer;
+        CHECK( buffer.write_tentative( 1));
+        CHECK( buffer.write_tentative( 2));
+        buffer.commit();
+        CHECK( buffer.write_tentative( 3));
+        CHECK( buffer.write_tentative( 4));
+
+        CHECK( buffer.write_tentative( 5)); // drops 1
+        CHECK( buffer.write_tentative( 6)); // drops 2
+        CHECK( not buffer.write_tentative( 7)); // only uncommitted values left
+        CHECK_EQUAL( 2u, buffer.overwritten());
+        CHECK( buffer.empty());
+
+        CHECK_EQUAL( 4u, buffer.commit());
+        for (uint8_t expected = 3; expected <= 6; ++expected)
+        {
+            uint8_t value = 0;
+            CHECK( buffer.read( &value));
+            CHECK_EQUAL( expected, value);
+        }
+    }
+
+    /// the overwrite policy counts dropped values, saturating at 0xffff, and keeps track of
+    /// the highest fill level.
+    void test_overwrite_statistics()
+    {
+        static overwriting_buffer buffer;
+        CHECK( buffer.write_tentative( 1));
+        CHECK( buffer.write_tentative( 2));
+        buffer.commit();
+        CHECK_EQUAL( 2u, buffer.high_water_mark());
+
+        for (uint32_t count = 0; count < 0x10010; ++count)
+        {
+            buffer.write_tentative( static_cast<uint8_t>( count));
+            buffer.commit();
+        }
+        CHECK_EQUAL( 0xffffu, buffer.overwritten());
+        CHECK_EQUAL( 4u, buffer.high_water_mark());
+
+        buffer.reset_statistics();
+        CHECK_EQUAL( 0u, buffer.overwritten());
+        CHECK_EQUAL( 0u, buffer.high_water_mark());
+    }
+
+    /// write_span() writes all values or none, also across the end of the buffer.
+    void test_write_span()
+    {
+        static round_robin_buffer< 8> buffer;
+        const uint8_t values[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+        CHECK( not buffer.write_span( values, 9));
+        CHECK_EQUAL( 8u, buffer.available());
+
+        CHECK( buffer.write_span( values, 6));
+        buffer.commit();
+        uint8_t out[8];
+        CHECK_EQUAL( 6u, buffer.read_span( out, 8));
+
+        // read and write indices are at 6 now, so this wraps.
+        CHECK( buffer.write_span( values, 5));
+        CHECK_EQUAL( 5u, buffer.commit());
+        const uint8_t *region;
+        CHECK_EQUAL( 2u, buffer.peek_span( region));
+        CHECK_EQUAL( 1u, region[0]);
+        CHECK_EQUAL( 5u, *buffer.at( 4));
+
+        CHECK_EQUAL( 5u, buffer.read_span( out, 8));
+        for (uint8_t index = 0; index < 5; ++index)
+        {
+            CHECK_EQUAL( values[index], out[index]);
+        }
+        CHECK( buffer.empty());
+    }
+
+    /// values can be written in place through writable_span() and read in place through
+    /// peek_span() and consume().
+    void test_in_place_spans()
+    {
+        static round_robin_buffer< 8> buffer;
+        uint8_t *region;
+        CHECK_EQUAL( 8u, buffer.writable_span( region));
+        region[0] = 10;
+        region[1] = 11;
+        region[2] = 12;
+        buffer.advance_tentative( 3);
+        CHECK_EQUAL( 5u, buffer.available());
+        CHECK_EQUAL( 3u, buffer.uncommitted());
+        buffer.commit();
+        CHECK_EQUAL( 0u, buffer.uncommitted());
+
+        const uint8_t *committed;
+        CHECK_EQUAL( 3u, buffer.peek_span( committed));
+        CHECK_EQUAL( 11u, committed[1]);
+        buffer.consume( 2);
+        CHECK_EQUAL( 1u, buffer.size());
+
+        uint8_t value;
+        CHECK( buffer.read( &value));
+        CHECK_EQUAL( 12u, value);
+
+        // only the part up to the end of the buffer is contiguous.
+        CHECK_EQUAL( 5u, buffer.writable_span( region));
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_16_bit_indices);
+    RUN_TEST( test_tentative_fill_is_not_committed);
+    RUN_TEST( test_reset_tentative_fill);
+    RUN_TEST( test_overwrite_keeps_uncommitted_values);
+    RUN_TEST( test_overwrite_committed_values);
+    RUN_TEST( test_overwrite_partly_committed);
+    RUN_TEST( test_overwrite_statistics);
+    RUN_TEST( test_write_span);
+    RUN_TEST( test_in_place_spans);
+    return test_result();
+}
@@ -0,0 +1,106 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/devices/software_uart.hpp"
+#include "check.hpp"
+
+namespace
+{
+    typedef serial::software_uart< PIN_TYPE( D, 5), PIN_TYPE( D, 4), 9600> uart_type;
+    uart_type gps;
+}
+
+IMPLEMENT_SOFTWARE_UART_INTERRUPTS( gps)
+
+namespace
+{
+    const uint8_t tx_bit = _BV( 5);
+    const uint8_t rx_bit = _BV( 4);
+
+    /// init() makes the tx pin an idle (high) output and starts timer 1 without prescaler.
+    void test_init()
+    {
+        CHECK( DDRD & tx_bit);
+        CHECK( PORTD & tx_bit);
+        CHECK( not (DDRD & rx_bit));
+        CHECK_EQUAL( _BV( CS10), TCCR1B);
+        CHECK( not gps.is_sending());
+    }
+
+    /// play the part of timer 1: every compare match A sends one bit of 'A', lsb first
+    /// between a start and a stop bit, one bit time after the previous one.
+    void test_transmit_bit_sequence()
+    {
+        TCNT1 = 1000;
+        gps.send( 'A');
+        CHECK( gps.is_sending());
+        CHECK( TIMSK1 & _BV( OCIE1A));
+        CHECK_EQUAL( 1000 + uart_type::bit_ticks, OCR1A);
+
+        const bool expected[] = { 0, 1, 0, 0, 0, 0, 0, 1, 0, 1};
+        for (uint8_t bit = 0; bit < sizeof expected; ++bit)
+        {
+            const uint16_t compare = OCR1A;
+            TIMER1_COMPA_vect();
+            CHECK_EQUAL( expected[bit], (PORTD & tx_bit) != 0);
+            CHECK_EQUAL( uint16_t( compare + uart_type::bit_ticks), OCR1A);
+        }
+
+        // after the stop bit, the transmitter stops its interrupt.
+        TIMER1_COMPA_vect();
+        CHECK( not gps.is_sending());
+        CHECK( not (TIMSK1 & _BV( OCIE1A)));
+        CHECK( PORTD & tx_bit);
+    }
+
+    /// play the part of the line: a start bit edge schedules samples in the middle of
+    /// every bit and a byte with a valid stop bit is received.
+    void test_receive()
+    {
+        TCNT1 = 0;
+        PIND = 0;
+        gps.receive_edge_interrupt( false);
+        CHECK( TIMSK1 & _BV( OCIE1B));
+        CHECK_EQUAL( uart_type::bit_ticks + uart_type::bit_ticks / 2, OCR1B);
+
+        const uint8_t value = 'Z';
+        for (uint8_t bit = 0; bit < 8; ++bit)
+        {
+            PIND = (value & _BV( bit)) ? rx_bit : 0;
+            TIMER1_COMPB_vect();
+        }
+        CHECK( not gps.data_available());
+
+        PIND = rx_bit; // stop bit
+        TIMER1_COMPB_vect();
+        CHECK( not (TIMSK1 & _BV( OCIE1B)));
+        CHECK( gps.data_available());
+        CHECK_EQUAL( value, gps.get());
+    }
+
+    /// a byte without a stop bit is dropped.
+    void test_receive_framing_error()
+    {
+        PIND = 0;
+        gps.receive_edge_interrupt( false);
+        for (uint8_t bit = 0; bit < 9; ++bit)
+        {
+            TIMER1_COMPB_vect();
+        }
+        CHECK( not gps.data_available());
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_init);
+    RUN_TEST( test_transmit_bit_sequence);
+    RUN_TEST( test_receive);
+    RUN_TEST( test_receive_framing_error);
+
+    return test_result();
+}
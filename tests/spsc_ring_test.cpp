@@ -0,0 +1,92 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/spsc_ring.hpp"
+#include "check.hpp"
+
+#include <thread>
+
+namespace
+{
+    /// push a sequence of numbers from one thread and pop them in another. With the
+    /// std_atomic_ordering, every value must arrive exactly once and in order, for all
+    /// ring sizes and for both 8-bit and 16-bit indices.
+    template< uint16_t size, typename value_type>
+    void stress()
+    {
+        static spsc::ring< size, value_type> ring;
+        const uint32_t count = 1000000;
+
+        std::thread producer( []()
+            {
+                for (uint32_t index = 0; index < count; )
+                {
+                    if (ring.push( static_cast< value_type>( index))) ++index;
+                    else std::this_thread::yield();
+                }
+            });
+
+        uint32_t errors = 0;
+        for (uint32_t index = 0; index < count; )
+        {
+            value_type value;
+            if (ring.pop( value))
+            {
+                if (value != static_cast< value_type>( index)) ++errors;
+                ++index;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        CHECK_EQUAL( 0u, errors);
+        CHECK( ring.empty());
+    }
+
+    void test_threaded_producer_consumer()
+    {
+        stress< 1, uint32_t>();
+        stress< 16, uint8_t>();
+        stress< 128, uint32_t>();    // largest ring with 8-bit indices
+        stress< 256, uint16_t>();    // smallest ring with 16-bit indices
+        stress< 4096, uint32_t>();
+    }
+
+    /// the ring is full after 'size' pushes and returns values in order.
+    void test_full_and_empty()
+    {
+        static spsc::ring< 8> ring;
+        for (uint8_t value = 0; value < 8; ++value)
+        {
+            CHECK( ring.push( value));
+        }
+        CHECK( ring.full());
+        CHECK( not ring.push( 8));
+        CHECK_EQUAL( 8u, ring.size());
+
+        uint8_t value = 0;
+        CHECK( ring.peek( value));
+        CHECK_EQUAL( 0u, value);
+        for (uint8_t expected = 0; expected < 8; ++expected)
+        {
+            CHECK( ring.pop( value));
+            CHECK_EQUAL( expected, value);
+        }
+        CHECK( ring.empty());
+        CHECK( not ring.pop( value));
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_full_and_empty);
+    RUN_TEST( test_threaded_producer_consumer);
+    return test_result();
+}
@@ -0,0 +1,17 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+// This file must not compile: 115200 baud at 16Mhz is 2.1% off, more than the default 2%.
+// expected error: baud rate cannot be reached accurately enough at this F_CPU
+#include "avr_utilities/devices/uart.h"
+
+serial::uart< 8, 8, 0, serial::baud< 115200> > console;
+
+int main()
+{
+    return 0;
+}
@@ -0,0 +1,259 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/devices/uart.h"
+#include "check.hpp"
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    /// a uart on a half duplex bus, with its driver enable pin on PD2.
+    serial::uart< 8, 8, 0, serial::half_duplex< PIN_TYPE( D, 2)> > bus( 9600);
+
+    /// a uart on the second USART.
+    serial::uart< 8, 8, 1> gps( 19200);
+
+    // options can be given in any order and the others keep their defaults.
+    typedef serial::uart< 8, 8, 0, serial::multiprocessor, serial::baud< 9600> > options_uart;
+    static_assert( options_uart::addressing::enabled, "multiprocessor option not selected");
+    static_assert( not options_uart::rx_framing::enabled, "framing should default to no_framing");
+    static_assert( options_uart::baud_rate::ubrr == 103, "baud option not selected");
+
+    // at 16Mhz, 9600 baud is as accurate in normal mode as with U2X, 57600 baud needs U2X.
+    static_assert( not serial::baud< 9600>::use_u2x, "normal mode expected");
+    static_assert( serial::baud< 57600>::use_u2x and serial::baud< 57600>::ubrr == 34, "U2X expected");
+    static_assert( serial::baud< 115200, 25>::ubrr == 16 and serial::baud< 115200, 25>::error == 21,
+            "wrong error for 115200 baud");
+}
+
+IMPLEMENT_UART_INTERRUPT( bus)
+IMPLEMENT_UART_TX_INTERRUPT( bus)
+IMPLEMENT_USART_INTERRUPT( 1, gps)
+
+namespace
+{
+    /// play the part of the USART: run the data register empty interrupt until the uart
+    /// is idle and collect the transmitted bytes in 'output' as a zero-terminated string.
+    template< typename uart_type>
+    void transmit( uart_type &uart, char *output, uint16_t size)
+    {
+        uint16_t count = 0;
+        while (uart.is_sending() && count < size - 1)
+        {
+            uart.output_buffer_empty_interrupt();
+            if (uart.is_sending()) output[count++] = UDR0;
+        }
+        output[count] = 0;
+    }
+
+    /// play the part of the USART: receive the bytes of a zero-terminated string.
+    template< typename uart_type>
+    void receive( uart_type &uart, const char *input)
+    {
+        while (*input)
+        {
+            UDR0 = *input++;
+            uart.input_buffer_full_interrupt();
+        }
+    }
+
+    /// output that exactly fills the output buffer while flash strings are queued is
+    /// sent in the order of the calls.
+    void test_output_fills_buffer_between_flash_strings()
+    {
+        static serial::uart< 8> uart( 9600);
+        uart.output_buffer_empty_interrupt(); // the USART has nothing to send yet.
+
+        uart.send( F_("AAAA"));
+        CHECK_EQUAL( static_cast<const char *>( 0), uart.send_some( "12345678"));
+        uart.send( F_("BBBB"));
+
+        char output[32];
+        transmit( uart, output, sizeof output);
+        CHECK_EQUAL( 0, strcmp( "AAAA12345678BBBB", output));
+    }
+
+    /// send_some() takes as much as fits in the output buffer and returns the rest, which
+    /// can be offered again once the USART has made room.
+    void test_send_some()
+    {
+        static serial::uart< 8> uart( 9600);
+        uart.output_buffer_empty_interrupt();
+
+        uart.send( "");
+        CHECK( not uart.is_sending());
+        CHECK( uart.send_some( static_cast<const char *>( 0)) == 0);
+
+        const char *message = "0123456789abc";
+        const char *rest = uart.send_some( message);
+        CHECK( rest == message + 8);
+
+        char output[32];
+        transmit( uart, output, sizeof output);
+        CHECK_EQUAL( 0, strcmp( "01234567", output));
+
+        CHECK( uart.send_some( rest) == 0);
+        transmit( uart, output, sizeof output);
+        CHECK_EQUAL( 0, strcmp( "89abc", output));
+
+        const uint8_t block[] = { 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J'};
+        CHECK_EQUAL( 8u, uart.send_some( block, sizeof block));
+        CHECK_EQUAL( 0u, uart.send_some( block + 8, 2));
+        transmit( uart, output, sizeof output);
+        CHECK_EQUAL( 0, strcmp( "ABCDEFGH", output));
+        CHECK_EQUAL( 2u, uart.send_some( block + 8, 2));
+        transmit( uart, output, sizeof output);
+        CHECK_EQUAL( 0, strcmp( "IJ", output));
+    }
+
+    /// when the descriptor queue is full, committed output waits until the interrupt
+    /// handler has taken a descriptor from the queue.
+    void test_output_waits_for_descriptor_queue()
+    {
+        static serial::uart< 8> uart( 9600);
+        uart.output_buffer_empty_interrupt();
+
+        uart.send( F_("AAAA"));
+        uart.send( F_("BBBB"));
+        uart.send( F_("CCCC"));
+        uart.send( F_("DDDD"));
+
+        // play the part of the USART while send() waits for a free descriptor.
+        std::thread usart( []
+            {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 50));
+                uart.output_buffer_empty_interrupt();
+            });
+        uart.send( "ram");
+        usart.join();
+
+        char output[32];
+        output[0] = UDR0;
+        transmit( uart, output + 1, sizeof output - 1);
+        CHECK_EQUAL( 0, strcmp( "AAAABBBBCCCCDDDDram", output));
+    }
+
+    /// a frame that does not fit in the input buffer is dropped and the next frame
+    /// is received normally.
+    void test_oversized_frame_is_dropped()
+    {
+        static serial::uart< 8, 8, 0, serial::line_frames, serial::uart_statistics::counters> uart( 9600);
+        uint8_t frame[8];
+
+        receive( uart, "abc");
+        CHECK( not uart.data_available());
+        receive( uart, "\n");
+        CHECK_EQUAL( 1u, uart.frames_available());
+
+        receive( uart, "0123456789\n");
+        CHECK_EQUAL( 1u, uart.frames_available());
+        CHECK_EQUAL( 11u, uart.dropped()); // the complete frame, including its delimiter
+        CHECK_EQUAL( 4u, uart.read_frame( frame, sizeof frame));
+        CHECK_EQUAL( 0, memcmp( "abc\n", frame, 4));
+        CHECK_EQUAL( 0u, uart.frames_available());
+        CHECK( not uart.data_available());
+
+        receive( uart, "0123456");
+        CHECK( not uart.data_available());
+        receive( uart, "\n");
+        CHECK_EQUAL( 1u, uart.frames_available());
+        CHECK_EQUAL( 8u, uart.read_frame( frame, sizeof frame));
+        CHECK_EQUAL( 0, memcmp( "0123456\n", frame, 8));
+
+        // the delimiter of a frame that fills the buffer does not fit either.
+        receive( uart, "01234567\nhi\n");
+        CHECK_EQUAL( 1u, uart.frames_available());
+        CHECK_EQUAL( 3u, uart.read_frame( frame, sizeof frame));
+        CHECK_EQUAL( 0, memcmp( "hi\n", frame, 3));
+        CHECK_EQUAL( 20u, uart.dropped());
+    }
+
+    /// the interrupt macros connect the vectors to the uart. The transmit complete
+    /// interrupt releases the bus when all output has been sent.
+    void test_half_duplex_interrupts()
+    {
+        USART_UDRE_vect(); // the USART has nothing to send yet.
+        USART_TX_vect();
+        CHECK_EQUAL( 0, PORTD & _BV( 2));
+
+        bus.send( "hi");
+        CHECK( PORTD & _BV( 2));
+
+        USART_UDRE_vect();
+        CHECK_EQUAL( 'h', UDR0);
+        USART_UDRE_vect();
+        CHECK_EQUAL( 'i', UDR0);
+        USART_TX_vect(); // the uart is not idle yet, so it keeps driving the bus
+        CHECK( PORTD & _BV( 2));
+
+        USART_UDRE_vect();
+        CHECK( not bus.is_sending());
+        USART_TX_vect();
+        CHECK_EQUAL( 0, PORTD & _BV( 2));
+    }
+
+    /// a uart on USART 1 configures, sends and receives through the registers and
+    /// interrupt vectors of USART 1 only.
+    void test_second_usart()
+    {
+        CHECK_EQUAL( 51, UBRR1L);
+        CHECK_EQUAL( 0, UBRR1H);
+        CHECK_EQUAL( _BV( RXCIE1) | _BV( RXEN1) | _BV( TXEN1) | _BV( UDRIE1), UCSR1B);
+        CHECK_EQUAL( _BV( UCSZ11) | _BV( UCSZ10), UCSR1C);
+        CHECK_EQUAL( 103, UBRR0L); // the half duplex bus on USART 0 keeps its baud rate.
+
+        USART1_UDRE_vect(); // the USART has nothing to send yet.
+        CHECK( not gps.is_sending());
+
+        UDR0 = 0;
+        gps.send( "ok");
+        CHECK( gps.is_sending());
+        CHECK( not bus.is_sending());
+        USART1_UDRE_vect();
+        CHECK_EQUAL( 'o', UDR1);
+        USART1_UDRE_vect();
+        CHECK_EQUAL( 'k', UDR1);
+        USART1_UDRE_vect();
+        CHECK( not gps.is_sending());
+        CHECK_EQUAL( 0, UDR0);
+
+        UDR1 = 'x';
+        USART1_RX_vect();
+        CHECK( gps.data_available());
+        CHECK( not bus.data_available());
+        CHECK_EQUAL( 'x', gps.get());
+    }
+
+    /// a uart with a compile time baud rate sets UBRR and the U2X bit in its constructor.
+    void test_compile_time_baud()
+    {
+        static serial::uart< 8, 8, 0, serial::baud< 57600> > fast;
+        CHECK_EQUAL( 34, UBRR0L);
+        CHECK_EQUAL( 0, UBRR0H);
+        CHECK_EQUAL( _BV( U2X0), UCSR0A);
+
+        static serial::uart< 8, 8, 0, serial::baud< 300> > slow;
+        CHECK_EQUAL( 3332 & 0xff, UBRR0L);
+        CHECK_EQUAL( 3332 >> 8, UBRR0H);
+        CHECK_EQUAL( 0, UCSR0A);
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_output_fills_buffer_between_flash_strings);
+    RUN_TEST( test_send_some);
+    RUN_TEST( test_output_waits_for_descriptor_queue);
+    RUN_TEST( test_oversized_frame_is_dropped);
+    RUN_TEST( test_half_duplex_interrupts);
+    RUN_TEST( test_second_usart);
+    RUN_TEST( test_compile_time_baud);
+    return test_result();
+}
@@ -0,0 +1,116 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "avr_utilities/simulation/vcd_writer.hpp"
+#include "check.hpp"
+
+#include <string.h>
+
+using namespace pin_definitions;
+
+namespace
+{
+    DECLARE_PIN( clk, B, 1)
+    DECLARE_PIN_GROUP( data, D, 4, 2)
+
+    /// read everything that was written to a temporary file.
+    void read_all( FILE *file, char *buffer, size_t size)
+    {
+        rewind( file);
+        const size_t length = fread( buffer, 1, size - 1, file);
+        buffer[length] = 0;
+    }
+
+    /// the writer dumps the initial values, and then every change of a signal at the
+    /// (simulated) time of the register write, at 62.5ns per cycle for a 16MHz clock.
+    void test_dump()
+    {
+        FILE *out = tmpfile();
+        CHECK( out);
+        if (not out) return;
+
+        simulation::register_file::instance().reset();
+        make_output( clk);
+        {
+            simulation::vcd_writer vcd( out);
+            CHECK( VCD_SIGNAL( vcd, clk));
+            CHECK( vcd.add_signal( "bus.data", data));
+            vcd.start();
+
+            // signals can not be added after start().
+            CHECK( not vcd.add_signal( "late", clk));
+
+            set( clk);
+            make_output( data);
+            write( data, 2);
+            reset( clk);
+            vcd.finish();
+        }
+
+        static const char expected[] =
+                "$timescale 1ps $end\n"
+                "$scope module avr $end\n"
+                "$var wire 1 ! clk $end\n"
+                "$var wire 2 \" bus_data $end\n"
+                "$upscope $end\n"
+                "$enddefinitions $end\n"
+                "#125000\n"
+                "$dumpvars\n"
+                "0!\n"
+                "bzz \"\n"
+                "$end\n"
+                "#250000\n"
+                "1!\n"
+                "#375000\n"
+                "b00 \"\n"
+                "#500000\n"
+                "b10 \"\n"
+                "#625000\n"
+                "0!\n"
+                "#625000\n";
+
+        char written[512];
+        read_all( out, written, sizeof written);
+        fclose( out);
+        CHECK_EQUAL( 0, strcmp( expected, written));
+    }
+
+    /// writes that do not change a signal, and writes to other ports, are not dumped.
+    void test_no_change_no_output()
+    {
+        FILE *out = tmpfile();
+        CHECK( out);
+        if (not out) return;
+
+        simulation::register_file::instance().reset();
+        make_output( clk);
+        simulation::vcd_writer vcd( out);
+        VCD_SIGNAL( vcd, clk);
+        vcd.start();
+        const long header = ftell( out);
+        reset( clk);
+        PORTC = 0xff;
+        make_output( clk);
+        vcd.finish();
+
+        char written[512];
+        read_all( out, written, sizeof written);
+        fclose( out);
+
+        // only the final timestamp follows the header.
+        CHECK_EQUAL( '#', written[header]);
+        CHECK( not strchr( written + header, '!'));
+    }
+}
+
+int main()
+{
+    RUN_TEST( test_dump);
+    RUN_TEST( test_no_change_no_output);
+
+    return test_result();
+}
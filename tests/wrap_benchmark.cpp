@@ -0,0 +1,68 @@
+//
+//  Copyright (C) 2017 Danny Havenith
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+//
+// Compares the code that round_robin_buffer generates for power-of-two sizes (indices
+// wrap with a mask) with the code for other sizes (indices wrap with a compare), and with
+// the modulo that the buffer used before. This is not a test: build it with an avr
+// compiler through 'make -C tests avr-benchmark', which lists the size of every function
+// and leaves the assembly in build/wrap_benchmark.s.
+//
+#include "avr_utilities/round_robin_buffer.h"
+
+namespace
+{
+    typedef round_robin_buffer< 32> masked_buffer;
+    typedef round_robin_buffer< 30> compare_buffer;
+
+    volatile masked_buffer masked;
+    volatile compare_buffer compared;
+
+    /// the old way of advancing an index.
+    template< uint8_t buffer_size>
+    uint8_t modulo_next( uint8_t index)
+    {
+        return (index + 1) % buffer_size;
+    }
+}
+
+extern "C"
+{
+    uint8_t next_masked_32( uint8_t index)
+    {
+        return round_robin_detail::wrap< 32>::next( index);
+    }
+
+    uint8_t next_compare_30( uint8_t index)
+    {
+        return round_robin_detail::wrap< 30>::next( index);
+    }
+
+    uint8_t next_modulo_30( uint8_t index)
+    {
+        return modulo_next< 30>( index);
+    }
+
+    bool write_masked_32( uint8_t value)
+    {
+        return masked.write_tentative( value);
+    }
+
+    bool write_compare_30( uint8_t value)
+    {
+        return compared.write_tentative( value);
+    }
+
+    uint8_t read_w_masked_32()
+    {
+        return masked.read_w();
+    }
+
+    uint8_t read_w_compare_30()
+    {
+        return compared.read_w();
+    }
+}